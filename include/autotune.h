@@ -0,0 +1,38 @@
+#ifndef AUTOTUNE_IS_DEF
+#define AUTOTUNE_IS_DEF
+
+#define AUTOTUNE_MAX_SCHEDULE 32
+
+// A tile shape along with an OpenMP schedule (see OMP_SCHEDULE)
+typedef struct
+{
+  unsigned tile_w, tile_h;
+  char schedule[AUTOTUNE_MAX_SCHEDULE];
+} autotune_config_t;
+
+// Returns 1 if the kernel accepts the configuration (see tile_check hooks)
+typedef int (*autotune_valid_func_t) (autotune_config_t *);
+// Runs nb_iter iterations using the configuration and returns the time
+// per iteration (µs)
+typedef double (*autotune_measure_func_t) (autotune_config_t *,
+                                           unsigned nb_iter);
+
+// Explores tile shapes (made of divisors of DIM) and schedule policies by
+// successive halving: every candidate runs first_iter iterations, then the
+// fastest half runs twice as many iterations (up to 16 x first_iter), and
+// so on until a single candidate remains.
+void autotune_search (autotune_config_t *best, unsigned first_iter,
+                      autotune_valid_func_t valid,
+                      autotune_measure_func_t measure);
+
+// Sets the schedule of loops using schedule(runtime), and OMP_SCHEDULE so
+// that it shows up in performance files and trace labels
+void autotune_apply_schedule (char *schedule);
+
+// The cache file holds the best configuration for each machine, kernel,
+// variant, tiling, DIM and number of threads. Returns 1 if the current
+// setup is found.
+int autotune_cache_lookup (char *filename, autotune_config_t *cfg);
+void autotune_cache_store (char *filename, autotune_config_t *cfg);
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef BENCH_IS_DEF
+#define BENCH_IS_DEF
+
+// Statistics over the timings (in µs) of repeated runs (see --bench)
+typedef struct
+{
+  unsigned runs;
+  long min, median;
+  double mean, stddev;
+  // Half-width of the 95% confidence interval of the mean (Student's t)
+  double ci95;
+} bench_stats_t;
+
+// Sorts samples in place
+void bench_compute_stats (long *samples, unsigned n, bench_stats_t *stats);
+
+#endif
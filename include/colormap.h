@@ -0,0 +1,52 @@
+#ifndef COLORMAP_IS_DEF
+#define COLORMAP_IS_DEF
+
+#include <stdint.h>
+
+#ifdef ENABLE_VECTO
+#if __AVX2__ == 1
+#include <immintrin.h>
+#endif
+#endif
+
+// A colormap is a palette computed once (e.g. at init time) and then
+// indexed by integer values (iteration counts, grain numbers, ...) so
+// that no color arithmetic remains in the compute/refresh loops.
+// Out-of-range indexes are clamped to the last entry.
+typedef struct
+{
+  unsigned size;
+  uint32_t *colors;
+} colormap_t;
+
+// Entry i is f (i)
+void colormap_init_func (colormap_t *cm, unsigned size,
+                         uint32_t (*f) (unsigned index, unsigned size));
+// Entry i is heat_to_rgb (i / (size - 1))
+void colormap_init_heat (colormap_t *cm, unsigned size);
+// Entry i is heat_to_3gauss_rgb (i / (size - 1))
+void colormap_init_3gauss (colormap_t *cm, unsigned size);
+// Entry i is hsv_to_rgb (i / size, s, v)
+void colormap_init_hsv (colormap_t *cm, unsigned size, float s, float v);
+void colormap_free (colormap_t *cm);
+
+static inline uint32_t colormap_lookup (const colormap_t *cm, unsigned index)
+{
+  return cm->colors[index < cm->size ? index : cm->size - 1];
+}
+
+#ifdef ENABLE_VECTO
+#if __AVX2__ == 1
+
+// Looks up 8 (unsigned) indexes at once using a gather
+static inline __m256i colormap_lookup_avx (const colormap_t *cm, __m256i index)
+{
+  index = _mm256_min_epu32 (index, _mm256_set1_epi32 (cm->size - 1));
+
+  return _mm256_i32gather_epi32 ((const int *)cm->colors, index, 4);
+}
+
+#endif
+#endif
+
+#endif
@@ -5,6 +5,12 @@
 #include "global.h"
 #include "api_funcs.h"
 #include "img_data.h"
+#include "colormap.h"
+#include "img_transpose.h"
+#include "sat.h"
+#include "pointwise.h"
+#include "pipeline.h"
+#include "tile_specialize.h"
 #include "hooks.h"
 #include "arch_flags.h"
 #include "debug.h"
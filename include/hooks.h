@@ -5,6 +5,7 @@ typedef void (*void_func_t) (void);
 typedef unsigned (*int_func_t) (unsigned);
 typedef void (*draw_func_t) (char *);
 typedef int (*tile_func_t) (int, int, int, int);
+typedef unsigned (*period_func_t) (void);
 
 extern draw_func_t the_config;
 extern void_func_t the_init;
@@ -14,10 +15,24 @@ extern void_func_t the_finalize;
 extern int_func_t the_compute;
 extern void_func_t the_refresh_img;
 extern void_func_t the_tile_check;
+extern period_func_t the_period;
 
+// With ENABLE_PLUGINS, loads lib/<kernel>.so (or $EASYPAP_PLUGIN_DIR/<kernel>.so)
+// unless already loaded. Does nothing otherwise. Plugins stay loaded until
+// exit: a rebuilt plugin is picked up by the next easypap run, not reloaded
+// between runs of the same process (kernel data lives in the plugin).
+void hooks_load_kernel (char *kernel);
+// Looks for symbol in loaded plugins, then in the main program
 void *hooks_find_symbol (char *symbol);
 void hooks_establish_bindings (int silent);
 
+// Once DIM and tile sizes are known, returns the function
+// ${kernel}_do_tile_${tile}_d${DIM}_${TILE_W}x${TILE_H} if it exists (see
+// tile_specialize.h), or NULL
+void *hooks_find_specialized_tile (char *kernel, char *tile);
+// Replaces the bound tile function by its specialized version, if any
+void hooks_specialize_tile (void);
+
 // Call function ${kernel}_draw_${suffix}, or default_func if symbol not found
 void hooks_draw_helper (char *suffix, void_func_t default_func);
 
@@ -7,13 +7,16 @@
 
 extern uint32_t *restrict image, *restrict alt_image;
 
-static inline uint32_t *img_cell (uint32_t *restrict i, int l, int c)
+static inline uint32_t *img_cell (uint32_t *restrict i, int l, int c,
+                                  unsigned dim)
 {
-  return i + l * DIM + c;
+  return i + l * dim + c;
 }
 
-#define cur_img(y, x) (*img_cell (image, (y), (x)))
-#define next_img(y, x) (*img_cell (alt_image, (y), (x)))
+// DIM is expanded where these macros are used, so that it becomes a
+// constant in specialized tile functions (see tile_specialize.h)
+#define cur_img(y, x) (*img_cell (image, (y), (x), DIM))
+#define next_img(y, x) (*img_cell (alt_image, (y), (x), DIM))
 
 static inline void swap_images (void)
 {
@@ -27,6 +30,18 @@ void img_data_alloc (void);
 void img_data_free (void);
 void img_data_replicate (void);
 
+// Saves both images, so that img_data_restore can bring them (and the
+// image pointers) back to this state, e.g. between benchmark runs
+void img_data_snapshot (void);
+void img_data_restore (void);
+void img_data_free_snapshot (void);
+
+// Ring buffer mode (must be requested from the init hook, before images are
+// allocated): scrolling the main image up by n rows is then O(1) and only
+// changes the image pointer. The alternate image is not affected.
+void img_data_use_ring_buffer (void);
+void img_data_scroll (int rows);
+
 // Useful color functions
 
 static inline int extract_red (uint32_t c)
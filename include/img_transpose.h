@@ -0,0 +1,23 @@
+#ifndef IMG_TRANSPOSE_IS_DEF
+#define IMG_TRANSPOSE_IS_DEF
+
+#include <stdint.h>
+
+// Flags for img_transpose_block
+enum
+{
+  TRANSPOSE_FLIP_ROWS = 1, // destination row i becomes row DIM - 1 - i
+  TRANSPOSE_STREAM    = 2  // use non-temporal stores for the destination
+};
+
+// For i in [y..y+h-1] and j in [x..x+w-1], copies src (j, i) into
+// dst (i, j), or into dst (DIM - 1 - i, j) if TRANSPOSE_FLIP_ROWS is set
+// (i.e. a 90° counterclockwise rotation). Both images are DIM x DIM.
+//
+// The block is recursively split along its largest dimension (cache
+// oblivious), down to 8x8 blocks transposed in AVX2 registers when
+// available.
+void img_transpose_block (uint32_t *restrict dst, uint32_t *restrict src,
+                          int x, int y, int w, int h, int flags);
+
+#endif
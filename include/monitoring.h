@@ -2,6 +2,7 @@
 #define MONITORING_IS_DEF
 
 #include "gmonitor.h"
+#include "perfcounter.h"
 #include "time_macros.h"
 #include "trace_record.h"
 
@@ -12,11 +13,46 @@ static inline void monitoring_declare_task_ids (char *task_ids[])
   trace_record_declare_task_ids (task_ids);
 }
 
+// Hardware counters are only sampled when tracing. Reads happen outside of
+// the [start, end] time interval of tiles and iterations.
+static inline void monitoring_counters_start_iteration (void)
+{
+  if (do_trace && do_perfcounters)
+    perfcounter_start_iteration ();
+}
+
+static inline void monitoring_counters_end_iteration (void)
+{
+  if (do_trace && do_perfcounters) {
+    perfcounter_values_t v;
+
+    perfcounter_end_iteration (&v);
+    trace_record_iteration_counters (v.value);
+  }
+}
+
+static inline void monitoring_counters_start_tile (unsigned cpu)
+{
+  if (do_trace && do_perfcounters)
+    perfcounter_start_tile (cpu);
+}
+
+static inline void monitoring_counters_end_tile (unsigned cpu)
+{
+  if (do_trace && do_perfcounters) {
+    perfcounter_values_t v;
+
+    perfcounter_end_tile (cpu, &v);
+    trace_record_tile_counters (cpu, v.value);
+  }
+}
+
 #ifdef ENABLE_SDL
 
 static inline long monitoring_start_iteration (void)
 {
   if (do_gmonitor | do_trace) {
+    monitoring_counters_start_iteration ();
     long t = what_time_is_it ();
     gmonitor_start_iteration (t);
     trace_record_start_iteration (t);
@@ -29,6 +65,7 @@ static inline long monitoring_end_iteration (void)
 {
   if (do_gmonitor | do_trace) {
     long t = what_time_is_it ();
+    monitoring_counters_end_iteration ();
     gmonitor_end_iteration (t);
     trace_record_end_iteration (t);
     return t;
@@ -39,6 +76,7 @@ static inline long monitoring_end_iteration (void)
 static inline void monitoring_start_tile (unsigned cpu)
 {
   if (do_gmonitor | do_trace) {
+    monitoring_counters_start_tile (cpu);
     long t = what_time_is_it ();
     gmonitor_start_tile (t, cpu);
     trace_record_start_tile (t, cpu);
@@ -50,6 +88,7 @@ static inline void monitoring_end_tile (unsigned x, unsigned y, unsigned w,
 {
   if (do_gmonitor | do_trace) {
     long t = what_time_is_it ();
+    monitoring_counters_end_tile (cpu);
     gmonitor_end_tile (t, cpu, x, y, w, h);
     trace_record_end_tile (t, cpu, x, y, w, h, TASK_TYPE_COMPUTE, 0);
   }
@@ -61,6 +100,7 @@ static inline void monitoring_end_tile_id (unsigned x, unsigned y, unsigned w,
 {
   if (do_gmonitor | do_trace) {
     long t = what_time_is_it ();
+    monitoring_counters_end_tile (cpu);
     gmonitor_end_tile (t, cpu, x, y, w, h);
     trace_record_end_tile (t, cpu, x, y, w, h, TASK_TYPE_COMPUTE, task_id + 1);
   }
@@ -85,6 +125,7 @@ static inline void monitoring_gpu_tile (unsigned x, unsigned y, unsigned w,
 static inline long monitoring_start_iteration (void)
 {
   if (do_trace) {
+    monitoring_counters_start_iteration ();
     long t = what_time_is_it ();
     trace_record_start_iteration (t);
     return t;
@@ -96,6 +137,7 @@ static inline long monitoring_end_iteration (void)
 {
   if (do_trace) {
     long t = what_time_is_it ();
+    monitoring_counters_end_iteration ();
     trace_record_end_iteration (t);
     return t;
   } else
@@ -105,6 +147,7 @@ static inline long monitoring_end_iteration (void)
 static inline void monitoring_start_tile (unsigned cpu)
 {
   if (do_trace) {
+    monitoring_counters_start_tile (cpu);
     long t = what_time_is_it ();
     trace_record_start_tile (t, cpu);
   }
@@ -115,6 +158,7 @@ static inline void monitoring_end_tile (unsigned x, unsigned y, unsigned w,
 {
   if (do_trace) {
     long t = what_time_is_it ();
+    monitoring_counters_end_tile (cpu);
     trace_record_end_tile (t, cpu, x, y, w, h, TASK_TYPE_COMPUTE, 0);
   }
 }
@@ -125,6 +169,7 @@ static inline void monitoring_end_tile_id (unsigned x, unsigned y, unsigned w,
 {
   if (do_trace) {
     long t = what_time_is_it ();
+    monitoring_counters_end_tile (cpu);
     trace_record_end_tile (t, cpu, x, y, w, h, TASK_TYPE_COMPUTE, task_id + 1);
   }
 }
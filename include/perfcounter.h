@@ -0,0 +1,43 @@
+#ifndef PERFCOUNTER_IS_DEF
+#define PERFCOUNTER_IS_DEF
+
+#include <stdint.h>
+
+#include "trace_common.h"
+
+// Per-thread hardware counters (cycles, instructions, LLC misses, branch
+// misses) opened with perf_event_open (Linux only, see --perf-counters).
+// Counters the machine does not support are reported as 0 and are absent
+// from perfcounter_available ().
+
+extern unsigned do_perfcounters;
+
+typedef struct
+{
+  uint64_t value[NB_COUNTERS];
+} perfcounter_values_t;
+
+// Opens counters for each OpenMP thread: must be called outside parallel
+// regions
+void perfcounter_init (void);
+void perfcounter_finalize (void);
+
+// Bit mask of available counters (1 << COUNTER_xxx)
+unsigned perfcounter_available (void);
+
+// Zeroes the counters of all threads
+void perfcounter_reset (void);
+
+// Sum of counters over all threads
+void perfcounter_read_total (perfcounter_values_t *v);
+
+// Counters of thread cpu since its last call to perfcounter_start_tile
+void perfcounter_start_tile (unsigned cpu);
+void perfcounter_end_tile (unsigned cpu, perfcounter_values_t *v);
+
+// Counters of all threads since the last call to
+// perfcounter_start_iteration
+void perfcounter_start_iteration (void);
+void perfcounter_end_iteration (perfcounter_values_t *v);
+
+#endif
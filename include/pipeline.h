@@ -0,0 +1,42 @@
+#ifndef PIPELINE_IS_DEF
+#define PIPELINE_IS_DEF
+
+// A pipeline chains several kernels (e.g. -k invert+blur+pixelize): each
+// iteration applies every stage, in order, using the stage tile functions
+// (<kernel>_do_tile_<tiling> if it exists, <kernel>_do_tile_default
+// otherwise).
+//
+// To be used as a stage, a kernel must describe how its tile function
+// accesses the image by defining
+//
+//   void <kernel>_pipeline_stage (pipeline_stage_t *stage);
+//
+// which is called after the <kernel>_config hook.
+
+#define PIPELINE_MAX_STAGES 8
+
+typedef enum
+{
+  // Each pixel of cur_img is updated in place, from its own value only
+  PIPELINE_POINTWISE,
+  // cur_img is updated in place, by independent square blocks of 'size'
+  // pixels aligned on multiples of 'size'. Tiles must be made of blocks.
+  PIPELINE_BLOCK,
+  // next_img is computed from the pixels of cur_img located at most 'size'
+  // pixels away (size <= TILE_H), then images are swapped
+  PIPELINE_STENCIL
+} pipeline_stage_kind_t;
+
+typedef struct
+{
+  pipeline_stage_kind_t kind;
+  unsigned size;
+} pipeline_stage_t;
+
+typedef void (*pipeline_stage_func_t) (pipeline_stage_t *);
+
+// Binds the pipeline hooks (the_compute, the_config, ...) if kernel_name
+// contains several stages. Returns 0 otherwise.
+int pipeline_establish_bindings (void);
+
+#endif
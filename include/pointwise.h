@@ -0,0 +1,131 @@
+#ifndef POINTWISE_IS_DEF
+#define POINTWISE_IS_DEF
+
+#include <omp.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#include "global.h"
+#include "monitoring.h"
+
+#ifdef ENABLE_VECTO
+#if __AVX2__ == 1
+#define POINTWISE_AVX
+#include <immintrin.h>
+#endif
+#endif
+
+// Helpers applying a per-pixel function f (c, i, j) to a whole DIM x DIM
+// image: dst (i, j) = f (src (i, j), i, j). dst and src may be the same
+// image, but streaming stores only pay off when they differ (no read for
+// ownership of the destination lines).
+//
+// These functions split rows among the threads of the enclosing parallel
+// region, so that each thread sweeps a single contiguous range of rows that
+// hardware prefetchers can follow, and records it as one tile. They end
+// with a barrier and should be called from within a parallel region, e.g.
+//
+//   #pragma omp parallel
+//   pointwise_map (alt_image, image, my_pixel_func);
+//
+// Being inlined into the caller's parallel region, the per-pixel functions
+// are inlined too.
+
+// Streaming stores only pay off when the source and destination images do
+// not fit together in the last level cache. Otherwise, kernels had better
+// map the image in place.
+static inline int pointwise_use_streaming (void)
+{
+  long llc = sysconf (_SC_LEVEL3_CACHE_SIZE);
+
+  if (llc <= 0)
+    llc = sysconf (_SC_LEVEL2_CACHE_SIZE);
+
+  return 2L * DIM * DIM * sizeof (uint32_t) > (unsigned long)llc;
+}
+
+// Rows [*first, *last[ of the calling thread
+static inline void pointwise_rows (int *first, int *last)
+{
+  const int me = omp_get_thread_num ();
+  const int nt = omp_get_num_threads ();
+
+  *first = (long)DIM * me / nt;
+  *last  = (long)DIM * (me + 1) / nt;
+}
+
+typedef uint32_t (*pointwise_func_t) (uint32_t c, int i, int j);
+
+static inline void pointwise_map (uint32_t *dst,
+                                  uint32_t *src, pointwise_func_t f)
+{
+  const int me = omp_get_thread_num ();
+  int first, last;
+
+  pointwise_rows (&first, &last);
+
+  if (first < last) {
+    monitoring_start_tile (me);
+
+    for (int i = first; i < last; i++)
+      for (int j = 0; j < DIM; j++)
+        dst[i * DIM + j] = f (src[i * DIM + j], i, j);
+
+    monitoring_end_tile (0, first, DIM, last - first, me);
+  }
+#pragma omp barrier
+}
+
+#ifdef POINTWISE_AVX
+
+// fv (c, i, j) computes the 8 pixels (i, j..j+7) at once. f is used for
+// the remaining pixels when DIM is not a multiple of 8.
+typedef __m256i (*pointwise_avx_func_t) (__m256i c, int i, int j);
+
+static inline void pointwise_map_avx (uint32_t *dst,
+                                      uint32_t *src,
+                                      pointwise_func_t f,
+                                      pointwise_avx_func_t fv)
+{
+  const int vdim = DIM & ~7;
+  // Non-temporal stores require 32-byte aligned rows
+  const int stream = (dst != src) && !(DIM % 8) && !((uintptr_t)dst % 32);
+  const int me     = omp_get_thread_num ();
+  int first, last;
+
+  pointwise_rows (&first, &last);
+
+  if (first < last)
+    monitoring_start_tile (me);
+
+  for (int i = first; i < last; i++) {
+    uint32_t *d = dst + i * DIM;
+    uint32_t *s = src + i * DIM;
+
+    if (stream)
+      for (int j = 0; j < vdim; j += 8)
+        _mm256_stream_si256 (
+            (__m256i *)(d + j),
+            fv (_mm256_loadu_si256 ((__m256i *)(s + j)), i, j));
+    else
+      for (int j = 0; j < vdim; j += 8)
+        _mm256_storeu_si256 (
+            (__m256i *)(d + j),
+            fv (_mm256_loadu_si256 ((__m256i *)(s + j)), i, j));
+
+    for (int j = vdim; j < DIM; j++)
+      d[j] = f (s[j], i, j);
+  }
+
+  if (first < last)
+    monitoring_end_tile (0, first, DIM, last - first, me);
+
+  // Make streamed data globally visible before synchronizing
+  if (stream)
+    _mm_sfence ();
+#pragma omp barrier
+}
+
+#endif
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef SAT_IS_DEF
+#define SAT_IS_DEF
+
+#include <stdint.h>
+
+#include "img_data.h"
+
+// Summed-area tables (a.k.a. integral images) of the four RGBA channels.
+// Each plane holds (DIM + 1) x (DIM + 1) entries: entry (i, j) is the sum
+// of channel values over pixels [0..i-1] x [0..j-1]. Sums are computed
+// modulo 2^32, which still yields exact box sums as long as a box
+// contains less than 2^24 pixels.
+enum
+{
+  SAT_RED,
+  SAT_GREEN,
+  SAT_BLUE,
+  SAT_ALPHA,
+  SAT_NB_PLANES
+};
+
+typedef struct
+{
+  unsigned dim;
+  uint32_t *plane[SAT_NB_PLANES];
+} sat_t;
+
+void sat_init (sat_t *sat);
+void sat_free (sat_t *sat);
+
+// Builds the tables from a DIM x DIM image (in parallel if called outside
+// of an OpenMP parallel region)
+void sat_build (sat_t *sat, uint32_t *img);
+
+static inline uint32_t *sat_cell (const sat_t *sat, int p, int i, int j)
+{
+  return sat->plane[p] + i * (sat->dim + 1) + j;
+}
+
+// Sum of channel p over pixels [y0..y1-1] x [x0..x1-1]
+static inline uint32_t sat_box_sum (const sat_t *sat, int p, int x0, int y0,
+                                    int x1, int y1)
+{
+  return *sat_cell (sat, p, y1, x1) - *sat_cell (sat, p, y0, x1) -
+         *sat_cell (sat, p, y1, x0) + *sat_cell (sat, p, y0, x0);
+}
+
+// Mean color over pixels [y0..y1-1] x [x0..x1-1] (channels are truncated)
+static inline uint32_t sat_box_mean (const sat_t *sat, int x0, int y0, int x1,
+                                     int y1)
+{
+  unsigned n = (x1 - x0) * (y1 - y0);
+
+  return rgba (sat_box_sum (sat, SAT_RED, x0, y0, x1, y1) / n,
+               sat_box_sum (sat, SAT_GREEN, x0, y0, x1, y1) / n,
+               sat_box_sum (sat, SAT_BLUE, x0, y0, x1, y1) / n,
+               sat_box_sum (sat, SAT_ALPHA, x0, y0, x1, y1) / n);
+}
+
+#endif
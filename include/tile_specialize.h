@@ -0,0 +1,61 @@
+#ifndef TILE_SPECIALIZE_IS_DEF
+#define TILE_SPECIALIZE_IS_DEF
+
+// Compile-time specialization of tile functions for a fixed set of
+// (DIM, TILE_W, TILE_H) configurations.
+//
+// A kernel writes the body of its tile function once, as an inline
+// function whose last parameter is named DIM (it shadows the global
+// variable, so that cur_img and next_img use it):
+//
+//   TILE_SPECIALIZABLE int blur_tile_body(int x, int y, int width,
+//                                         int height, const unsigned DIM)
+//   { ... }
+//
+// then instantiates it with
+//
+//   TILE_SPECIALIZE(blur, default, blur_tile_body)
+//
+// which defines blur_do_tile_default (generic) plus one function
+// blur_do_tile_default_d<DIM>_<TILE_W>x<TILE_H> per configuration of
+// SPECIALIZED_CONFIGS. Once DIM is known, the specialized function is
+// picked instead of the generic one if the runtime parameters match (see
+// hooks_specialize_tile). Inside, DIM and the tile size are constants, so
+// the compiler can unroll and vectorize loops and fold index computations.
+
+// Configurations to specialize, as F(..., DIM, TILE_W, TILE_H) entries.
+// Can be redefined before this header is included (e.g. using -include).
+#ifndef SPECIALIZED_CONFIGS
+#define SPECIALIZED_CONFIGS(F, ...)                                            \
+  F (__VA_ARGS__, 512, 16, 16)                                                 \
+  F (__VA_ARGS__, 1024, 32, 32)                                                \
+  F (__VA_ARGS__, 2048, 32, 32)                                                \
+  F (__VA_ARGS__, 2048, 64, 64)                                                \
+  F (__VA_ARGS__, 4096, 64, 64)
+#endif
+
+// Bodies must be inlined in each instance for constants to be propagated
+#define TILE_SPECIALIZABLE static inline __attribute__ ((always_inline))
+
+#define TILE_SPECIALIZED_NAME(kernel, name, D, TW, TH)                         \
+  kernel##_do_tile_##name##_d##D##_##TW##x##TH
+
+// Specialized functions still accept tiles of another size (e.g. when
+// kernels call do_tile on smaller blocks), with DIM only being constant
+#define TILE_SPECIALIZE_ONE(kernel, name, body, D, TW, TH)                     \
+  int TILE_SPECIALIZED_NAME (kernel, name, D, TW, TH) (int x, int y,           \
+                                                       int width, int height)  \
+  {                                                                            \
+    if (width == TW && height == TH)                                           \
+      return body (x, y, TW, TH, D);                                           \
+    return body (x, y, width, height, D);                                      \
+  }
+
+#define TILE_SPECIALIZE(kernel, name, body)                                    \
+  int kernel##_do_tile_##name (int x, int y, int width, int height)            \
+  {                                                                            \
+    return body (x, y, width, height, DIM);                                    \
+  }                                                                            \
+  SPECIALIZED_CONFIGS (TILE_SPECIALIZE_ONE, kernel, name, body)
+
+#endif
@@ -2,12 +2,46 @@
 #include "easypap.h"
 
 #include <omp.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "vec_aligned_alloc.h"
+
+// Radius of the box filter used by the "sliding" tile functions. The
+// other tile functions always compute a 3x3 average (i.e. radius 1).
+// Row sums are stored on 16 bits and column sums must remain below 2^24.
+#define MAX_RADIUS 127
+
+static unsigned radius = 1;
+
+// Suggested cmdline(s):
+// ./run -l images/1024.png -k blur -v tiled -wt sliding -a 8
+//
+void blur_config(char *param)
+{
+  if (param != NULL)
+  {
+    int r = atoi(param);
+    if (r < 1 || r > MAX_RADIUS)
+      exit_with_error("Blur radius must be in [1..%d] (%s)", MAX_RADIUS, param);
+    radius = r;
+  }
+}
+
+// Can be used as a pipeline stage (e.g. -k invert+blur). Only the
+// "sliding" tile functions obey the radius.
+void blur_pipeline_stage(pipeline_stage_t *stage)
+{
+  stage->kind = PIPELINE_STENCIL;
+  stage->size = (tile_name != NULL && !strncmp(tile_name, "sliding", 7)) ? radius : 1;
+}
 
 ///////////////////////////// Sequential version (tiled)
 // Suggested cmdline(s):
 // ./run -l images/1024.png -k blur -v seq -si
 //
-int blur_do_tile_default(int x, int y, int width, int height)
+// The body is specialized for the configurations of tile_specialize.h
+TILE_SPECIALIZABLE int blur_tile_default(int x, int y, int width, int height, const unsigned DIM)
 {
   for (int i = y; i < y + height; i++)
     for (int j = x; j < x + width; j++)
@@ -41,6 +75,8 @@ int blur_do_tile_default(int x, int y, int width, int height)
   return 0;
 }
 
+TILE_SPECIALIZE(blur, default, blur_tile_default)
+
 int do_tile_inner(int x, int y, int width, int height)
 {
   for (int i = y; i < y + height; i++)
@@ -113,6 +149,25 @@ unsigned blur_compute_tiled(unsigned nb_iter)
   return 0;
 }
 
+///////////////////////////// Tiled parallel version (omp_tiled)
+// Suggested cmdline(s):
+// ./run -l images/1024.png -k blur -v omp_tiled -ts 32 -m si
+//
+unsigned blur_compute_omp_tiled(unsigned nb_iter)
+{
+  for (unsigned it = 1; it <= nb_iter; it++)
+  {
+#pragma omp parallel for collapse(2) schedule(runtime)
+    for (int y = 0; y < DIM; y += TILE_H)
+      for (int x = 0; x < DIM; x += TILE_W)
+        do_tile(x, y, TILE_W, TILE_H, omp_get_thread_num());
+
+    swap_images();
+  }
+
+  return 0;
+}
+
 ///////////////////////////// Tiled sequential version (tiled_opt)
 // Suggested cmdline(s):
 // ./run -l images/1024.png -k blur -v tiled_opt -ts 32 -m si
@@ -139,3 +194,451 @@ unsigned blur_compute_tiled_opt(unsigned nb_iter)
 
   return 0;
 }
+
+///////////////////////////// Sliding window tile functions (sliding)
+// The box filter is separable: each output pixel is the sum of (2R+1) row
+// sums of (2R+1) pixels, divided by the number of pixels inside the image.
+// Row sums are computed once per tile using a running sum along each row
+// (one add and one sub per pixel, whatever the radius), then a running sum
+// along columns produces the final sums. Channels are kept unpacked in
+// planar arrays so that the vertical pass can be vectorized.
+//
+// Suggested cmdline(s):
+// ./run -l images/1024.png -k blur -v omp_tiled -wt sliding -a 16
+// ./run -l images/1024.png -k blur -v omp_tiled -wt sliding_avx -a 16
+//
+
+typedef struct
+{
+  size_t h_size, v_size, img_size;
+  uint16_t *h;      // row sums: 4 planes of (height + 2R) x width
+  int32_t *v;       // column running sums: 4 planes of width
+  uint32_t *img[2]; // tile + halo buffers used by the omp_fused variant
+} blur_scratch_t;
+
+static blur_scratch_t *scratch = NULL;
+static unsigned nb_scratch     = 0;
+
+void blur_init(void)
+{
+  nb_scratch = easypap_requested_number_of_threads();
+  scratch    = calloc(nb_scratch, sizeof(blur_scratch_t));
+}
+
+void blur_finalize(void)
+{
+  for (int t = 0; t < nb_scratch; t++)
+  {
+    vec_aligned_free(scratch[t].h);
+    vec_aligned_free(scratch[t].v);
+    vec_aligned_free(scratch[t].img[0]);
+    vec_aligned_free(scratch[t].img[1]);
+  }
+  free(scratch);
+  scratch = NULL;
+}
+
+// Returns the calling thread's scratch buffers, large enough for a tile of
+// size width x height
+static blur_scratch_t *my_scratch(void)
+{
+  int me = omp_get_thread_num();
+
+  if (me >= nb_scratch)
+    exit_with_error("Thread %d has no scratch buffer (%d threads expected)", me, nb_scratch);
+
+  return scratch + me;
+}
+
+static blur_scratch_t *get_scratch(int width, int height)
+{
+  blur_scratch_t *s = my_scratch();
+  size_t h_size     = 4 * (height + 2 * radius) * width * sizeof(uint16_t);
+  size_t v_size     = 4 * width * sizeof(int32_t);
+
+  if (s->h_size < h_size)
+  {
+    if (s->h != NULL)
+      vec_aligned_free(s->h);
+    s->h      = vec_aligned_malloc(h_size);
+    s->h_size = h_size;
+  }
+  if (s->v_size < v_size)
+  {
+    if (s->v != NULL)
+      vec_aligned_free(s->v);
+    s->v      = vec_aligned_malloc(v_size);
+    s->v_size = v_size;
+  }
+
+  return s;
+}
+
+// Spreads the 4 channels of a pixel into 16-bit fields, so that the four
+// running sums of the horizontal pass fit in a single 64-bit integer
+static inline uint64_t spread(uint32_t c)
+{
+  return (uint64_t) (c & 0xFF) | ((uint64_t) (c & 0xFF00) << 8) | ((uint64_t) (c & 0xFF0000) << 16) |
+         ((uint64_t) (c & 0xFF000000) << 24);
+}
+
+static inline int window_first(int i)
+{
+  return (i > (int) radius) ? i - (int) radius : 0;
+}
+
+static inline int window_last(int i)
+{
+  return (i + radius < DIM) ? i + (int) radius : DIM - 1;
+}
+
+// Horizontal pass: computes the row sums of rows [first_row..last_row] for
+// columns [x..x+width-1]. Planes are ordered alpha, blue, green, red.
+static void sliding_row_sums(blur_scratch_t *s, int x, int width, int first_row, int last_row)
+{
+  const int nb_rows = last_row - first_row + 1;
+
+  for (int r = first_row; r <= last_row; r++)
+  {
+    uint16_t *h = s->h + (r - first_row) * width;
+    uint64_t sum = 0;
+
+    for (int c = window_first(x); c <= window_last(x); c++)
+      sum += spread(cur_img(r, c));
+
+    for (int j = 0; j < width; j++)
+    {
+      h[j]                         = sum;
+      h[j + nb_rows * width]       = sum >> 16;
+      h[j + 2 * nb_rows * width]   = sum >> 32;
+      h[j + 3 * nb_rows * width]   = sum >> 48;
+
+      int add = x + j + radius + 1, sub = x + j - (int) radius;
+      if (add < DIM)
+        sum += spread(cur_img(r, add));
+      if (sub >= 0)
+        sum -= spread(cur_img(r, sub));
+    }
+  }
+}
+
+int blur_do_tile_sliding(int x, int y, int width, int height)
+{
+  blur_scratch_t *s   = get_scratch(width, height);
+  const int first_row = window_first(y);
+  const int last_row  = window_last(y + height - 1);
+  const int nb_rows   = last_row - first_row + 1;
+
+  sliding_row_sums(s, x, width, first_row, last_row);
+
+  // Vertical pass
+  for (int p = 0; p < 4; p++)
+    for (int j = 0; j < width; j++)
+    {
+      uint16_t *h = s->h + p * nb_rows * width;
+      int32_t sum = 0;
+
+      for (int r = window_first(y); r <= window_last(y); r++)
+        sum += h[(r - first_row) * width + j];
+      s->v[p * width + j] = sum;
+    }
+
+  for (int i = y; i < y + height; i++)
+  {
+    const unsigned nr = window_last(i) - window_first(i) + 1;
+
+    for (int j = 0; j < width; j++)
+    {
+      const unsigned n = nr * (window_last(x + j) - window_first(x + j) + 1);
+      unsigned a       = s->v[j] / n;
+      unsigned b       = s->v[width + j] / n;
+      unsigned g       = s->v[2 * width + j] / n;
+      unsigned r       = s->v[3 * width + j] / n;
+
+      next_img(i, x + j) = rgba(r, g, b, a);
+    }
+
+    if (i + 1 < y + height)
+    {
+      const int add = i + radius + 1, sub = i - (int) radius;
+
+      for (int p = 0; p < 4; p++)
+      {
+        uint16_t *h = s->h + p * nb_rows * width;
+        int32_t *v  = s->v + p * width;
+
+        if (add < DIM)
+          for (int j = 0; j < width; j++)
+            v[j] += h[(add - first_row) * width + j];
+        if (sub >= 0)
+          for (int j = 0; j < width; j++)
+            v[j] -= h[(sub - first_row) * width + j];
+      }
+    }
+  }
+
+  return 0;
+}
+
+#ifdef ENABLE_VECTO
+
+#if __AVX2__ == 1
+
+#include <immintrin.h>
+
+void blur_tile_check_sliding_avx(void)
+{
+  // Tile width must be a multiple of AVX vector size
+  easypap_vec_check(AVX_VEC_SIZE_INT, DIR_HORIZONTAL);
+}
+
+// Adds (or subtracts) one plane row of 16-bit row sums to 32-bit running sums
+static inline void vertical_update(int32_t *v, uint16_t *h, int width, int sub)
+{
+  for (int j = 0; j < width; j += AVX_VEC_SIZE_INT)
+  {
+    __m256i sums = _mm256_loadu_si256((__m256i *) (v + j));
+    __m256i row  = _mm256_cvtepu16_epi32(_mm_loadu_si128((__m128i *) (h + j)));
+
+    sums = sub ? _mm256_sub_epi32(sums, row) : _mm256_add_epi32(sums, row);
+    _mm256_storeu_si256((__m256i *) (v + j), sums);
+  }
+}
+
+int blur_do_tile_sliding_avx(int x, int y, int width, int height)
+{
+  blur_scratch_t *s   = get_scratch(width, height);
+  const int first_row = window_first(y);
+  const int last_row  = window_last(y + height - 1);
+  const int nb_rows   = last_row - first_row + 1;
+  const __m256i lanes = _mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+  const __m256i vr    = _mm256_set1_epi32(radius);
+  const __m256i vmax  = _mm256_set1_epi32(DIM - 1);
+
+  sliding_row_sums(s, x, width, first_row, last_row);
+
+  for (int p = 0; p < 4; p++)
+  {
+    memset(s->v + p * width, 0, width * sizeof(int32_t));
+    for (int r = window_first(y); r <= window_last(y); r++)
+      vertical_update(s->v + p * width, s->h + (p * nb_rows + r - first_row) * width, width, 0);
+  }
+
+  for (int i = y; i < y + height; i++)
+  {
+    const __m256 nr = _mm256_set1_ps(window_last(i) - window_first(i) + 1);
+
+    for (int j = 0; j < width; j += AVX_VEC_SIZE_INT)
+    {
+      // Number of columns inside the image, for 8 consecutive pixels
+      __m256i col   = _mm256_add_epi32(_mm256_set1_epi32(x + j), lanes);
+      __m256i first = _mm256_max_epi32(_mm256_sub_epi32(col, vr), _mm256_setzero_si256());
+      __m256i last  = _mm256_min_epi32(_mm256_add_epi32(col, vr), vmax);
+      __m256 n      = _mm256_mul_ps(nr, _mm256_cvtepi32_ps(_mm256_sub_epi32(last, _mm256_sub_epi32(first, _mm256_set1_epi32(1)))));
+      __m256i color = _mm256_setzero_si256();
+
+      // Sums are smaller than 2^24, so that float divisions are exact
+      // enough to yield the same result as integer divisions
+      for (int p = 3; p >= 0; p--)
+      {
+        __m256 sum  = _mm256_cvtepi32_ps(_mm256_loadu_si256((__m256i *) (s->v + p * width + j)));
+        __m256i val = _mm256_cvttps_epi32(_mm256_div_ps(sum, n));
+
+        color = _mm256_or_si256(_mm256_slli_epi32(color, 8), val);
+      }
+
+      _mm256_storeu_si256((__m256i *) &next_img(i, x + j), color);
+    }
+
+    if (i + 1 < y + height)
+    {
+      const int add = i + radius + 1, sub = i - (int) radius;
+
+      for (int p = 0; p < 4; p++)
+      {
+        if (add < DIM)
+          vertical_update(s->v + p * width, s->h + (p * nb_rows + add - first_row) * width, width, 0);
+        if (sub >= 0)
+          vertical_update(s->v + p * width, s->h + (p * nb_rows + sub - first_row) * width, width, 1);
+      }
+    }
+  }
+
+  return 0;
+}
+
+#endif // AVX
+
+#endif
+
+///////////////////////////// Temporally fused version (omp_fused)
+// Each tile advances k iterations at once: the tile is copied along with
+// a halo of k pixels into a per-thread buffer, and every step computes a
+// region one pixel narrower than the previous one. Halos are recomputed
+// redundantly by neighbouring tiles, but the image is only streamed
+// through memory once every k iterations. The k parameter is given with
+// -a (default 2) and is reported in the "arg" column of perf files.
+//
+// Suggested cmdline(s):
+// ./run -l images/1024.png -k blur -v omp_fused -ts 64 -a 4
+//
+static unsigned fused_steps = 2;
+
+void blur_config_omp_fused(char *param)
+{
+  if (param != NULL)
+  {
+    int k = atoi(param);
+    if (k < 1)
+      exit_with_error("Number of fused iterations must be positive (%s)", param);
+    fused_steps = k;
+  }
+}
+
+// One 3x3 blur step on buffer src (covering [sx..sx+sw-1] x [sy..sy+sh-1]
+// in image coordinates), for the pixels of [x0..x1] x [y0..y1]
+static void fused_step(uint32_t *restrict dst, uint32_t *restrict src, int sx, int sy, int sw, int x0, int x1,
+                       int y0, int y1)
+{
+  for (int i = y0; i <= y1; i++)
+    for (int j = x0; j <= x1; j++)
+    {
+      unsigned r = 0, g = 0, b = 0, a = 0, n = 0;
+
+      int i_d = (i > 0) ? i - 1 : i;
+      int i_f = (i < DIM - 1) ? i + 1 : i;
+      int j_d = (j > 0) ? j - 1 : j;
+      int j_f = (j < DIM - 1) ? j + 1 : j;
+
+      for (int yloc = i_d; yloc <= i_f; yloc++)
+        for (int xloc = j_d; xloc <= j_f; xloc++)
+        {
+          unsigned c = src[(yloc - sy) * sw + xloc - sx];
+          r += extract_red(c);
+          g += extract_green(c);
+          b += extract_blue(c);
+          a += extract_alpha(c);
+          n += 1;
+        }
+
+      dst[(i - sy) * sw + j - sx] = rgba(r / n, g / n, b / n, a / n);
+    }
+}
+
+static void fused_tile(int x, int y, int width, int height, unsigned steps)
+{
+  blur_scratch_t *s = my_scratch();
+  const int sx = max(x - (int) steps, 0), ex = min(x + width + (int) steps, (int) DIM) - 1;
+  const int sy = max(y - (int) steps, 0), ey = min(y + height + (int) steps, (int) DIM) - 1;
+  const int sw = ex - sx + 1, sh = ey - sy + 1;
+  size_t size  = sw * sh * sizeof(uint32_t);
+
+  if (s->img_size < size)
+  {
+    for (int b = 0; b < 2; b++)
+    {
+      if (s->img[b] != NULL)
+        vec_aligned_free(s->img[b]);
+      s->img[b] = vec_aligned_malloc(size);
+    }
+    s->img_size = size;
+  }
+
+  uint32_t *src = s->img[0], *dst = s->img[1];
+
+  for (int i = sy; i <= ey; i++)
+    memcpy(src + (i - sy) * sw, &cur_img(i, sx), sw * sizeof(uint32_t));
+
+  for (int st = 1; st <= steps; st++)
+  {
+    // After step st, pixels up to (steps - st) away from the tile are valid
+    int halo = steps - st;
+
+    fused_step(dst, src, sx, sy, sw, max(x - halo, 0), min(x + width + halo, (int) DIM) - 1, max(y - halo, 0),
+               min(y + height + halo, (int) DIM) - 1);
+
+    uint32_t *tmp = src;
+    src           = dst;
+    dst           = tmp;
+  }
+
+  for (int i = y; i < y + height; i++)
+    memcpy(&next_img(i, x), src + (i - sy) * sw + x - sx, width * sizeof(uint32_t));
+}
+
+unsigned blur_compute_omp_fused(unsigned nb_iter)
+{
+  for (unsigned it = 1; it <= nb_iter; it += fused_steps)
+  {
+    unsigned steps = min(fused_steps, nb_iter - it + 1);
+
+#pragma omp parallel for collapse(2) schedule(runtime)
+    for (int y = 0; y < DIM; y += TILE_H)
+      for (int x = 0; x < DIM; x += TILE_W)
+      {
+        monitoring_start_tile(omp_get_thread_num());
+
+        fused_tile(x, y, TILE_W, TILE_H, steps);
+
+        monitoring_end_tile(x, y, TILE_W, TILE_H, omp_get_thread_num());
+      }
+
+    swap_images();
+  }
+
+  return 0;
+}
+
+///////////////////////////// Summed-area table version (sat)
+// Each iteration first builds the summed-area tables of the current image,
+// so that every box mean then costs four lookups per channel, whatever the
+// radius. Box sums are exact as long as boxes hold less than 2^24 pixels,
+// which MAX_RADIUS guarantees.
+// Suggested cmdline(s):
+// ./run -l images/1024.png -k blur -v sat -a 8 -m si
+//
+static sat_t sat;
+
+void blur_init_sat(void)
+{
+  sat_init(&sat);
+}
+
+void blur_finalize_sat(void)
+{
+  sat_free(&sat);
+}
+
+static void sat_tile(int x, int y, int width, int height)
+{
+  for (int i = y; i < y + height; i++)
+  {
+    const int y0 = window_first(i), y1 = window_last(i) + 1;
+
+    for (int j = x; j < x + width; j++)
+      next_img(i, j) = sat_box_mean(&sat, window_first(j), y0, window_last(j) + 1, y1);
+  }
+}
+
+unsigned blur_compute_sat(unsigned nb_iter)
+{
+  for (unsigned it = 1; it <= nb_iter; it++)
+  {
+    sat_build(&sat, image);
+
+#pragma omp parallel for collapse(2) schedule(runtime)
+    for (int y = 0; y < DIM; y += TILE_H)
+      for (int x = 0; x < DIM; x += TILE_W)
+      {
+        monitoring_start_tile(omp_get_thread_num());
+
+        sat_tile(x, y, TILE_W, TILE_H);
+
+        monitoring_end_tile(x, y, TILE_W, TILE_H, omp_get_thread_num());
+      }
+
+    swap_images();
+  }
+
+  return 0;
+}
@@ -3,6 +3,13 @@
 
 #include <omp.h>
 
+// Inverting twice gives back the original image: iterations can be folded
+// (see --fold-iterations)
+unsigned invert_period(void)
+{
+  return 2;
+}
+
 #define INV_MASK ((unsigned) 0xFFFFFF00)
 
 static inline unsigned compute_color(int i, int j)
@@ -10,15 +17,24 @@ static inline unsigned compute_color(int i, int j)
   return INV_MASK ^ cur_img(i, j);
 }
 
-int invert_do_tile_default(int x, int y, int width, int height)
+// Can be used as a pipeline stage (e.g. -k invert+blur)
+void invert_pipeline_stage(pipeline_stage_t *stage)
+{
+  stage->kind = PIPELINE_POINTWISE;
+}
+
+// The body is specialized for the configurations of tile_specialize.h
+TILE_SPECIALIZABLE int invert_tile_default(int x, int y, int width, int height, const unsigned DIM)
 {
   for (int i = y; i < y + height; i++)
     for (int j = x; j < x + width; j++)
-      cur_img(i, j) = compute_color(i, j);
+      cur_img(i, j) = INV_MASK ^ cur_img(i, j);
 
   return 0;
 }
 
+TILE_SPECIALIZE(invert, default, invert_tile_default)
+
 ///////////////////////////// Simple sequential version (seq)
 // Suggested cmdline(s):
 // ./run -l images/shibuya.png -k invert -v seq -i 100 -n
@@ -50,3 +66,48 @@ unsigned invert_compute_tiled(unsigned nb_iter)
 
   return 0;
 }
+
+///////////////////////////// Streaming parallel version (stream)
+// When image and alt_image do not fit together in the last level cache,
+// pixels are read from image and written to alt_image with AVX2 loads and
+// non-temporal stores (when available), so that the destination lines are
+// never read nor kept in the caches. Otherwise, the image is mapped in place.
+// Suggested cmdline(s):
+// OMP_NUM_THREADS=4 ./run -l images/shibuya.png -k invert -v stream -i 100 -n
+//
+static uint32_t invert_pixel(uint32_t c, int i, int j)
+{
+  return INV_MASK ^ c;
+}
+
+#ifdef POINTWISE_AVX
+static __m256i invert_pixel_avx(__m256i c, int i, int j)
+{
+  return _mm256_xor_si256(c, _mm256_set1_epi32(INV_MASK));
+}
+#endif
+
+unsigned invert_compute_stream(unsigned nb_iter)
+{
+  uint32_t *dst = pointwise_use_streaming() ? alt_image : image;
+
+  for (unsigned it = 1; it <= nb_iter; it++)
+  {
+#pragma omp parallel
+    {
+#ifdef POINTWISE_AVX
+      pointwise_map_avx(dst, image, invert_pixel, invert_pixel_avx);
+#else
+      pointwise_map(dst, image, invert_pixel);
+#endif
+    }
+
+    if (dst != image)
+    {
+      swap_images();
+      dst = alt_image;
+    }
+  }
+
+  return 0;
+}
@@ -73,14 +73,25 @@ unsigned mandel_compute_omp_tiled(unsigned nb_iter)
 #define MAX_ITERATIONS 4096
 #define ZOOM_SPEED     -0.01
 
-static float leftX   = -0.2395;
-static float rightX  = -0.2275;
-static float topY    = .660;
-static float bottomY = .648;
+#define INIT_LEFT_X   -0.2395
+#define INIT_RIGHT_X  -0.2275
+#define INIT_TOP_Y    .660
+#define INIT_BOTTOM_Y .648
+
+static float leftX   = INIT_LEFT_X;
+static float rightX  = INIT_RIGHT_X;
+static float topY    = INIT_TOP_Y;
+static float bottomY = INIT_BOTTOM_Y;
 
 static float xstep;
 static float ystep;
 
+// Iteration counts (0..MAX_ITERATIONS) are turned into colors using a
+// precomputed palette
+static colormap_t palette;
+
+static uint32_t iteration_to_color(unsigned iter, unsigned size);
+
 void mandel_init()
 {
   // check tile size's conformity with respect to CPU vector width
@@ -88,9 +99,30 @@ void mandel_init()
 
   xstep = (rightX - leftX) / DIM;
   ystep = (topY - bottomY) / DIM;
+
+  if (palette.colors == NULL)
+    colormap_init_func(&palette, MAX_ITERATIONS + 1, iteration_to_color);
+}
+
+// Restores the initial view, so that repeated runs (see --bench) compute
+// the same zoom sequence
+void mandel_draw(char *param)
+{
+  leftX   = INIT_LEFT_X;
+  rightX  = INIT_RIGHT_X;
+  topY    = INIT_TOP_Y;
+  bottomY = INIT_BOTTOM_Y;
+
+  xstep = (rightX - leftX) / DIM;
+  ystep = (topY - bottomY) / DIM;
 }
 
-static unsigned iteration_to_color(unsigned iter)
+void mandel_finalize()
+{
+  colormap_free(&palette);
+}
+
+static uint32_t iteration_to_color(unsigned iter, unsigned size)
 {
   unsigned r = 0, g = 0, b = 0;
 
@@ -171,7 +203,7 @@ static unsigned compute_one_pixel(int i, int j)
     zi = twoxy + ci;
   }
 
-  return iteration_to_color(iter);
+  return colormap_lookup(&palette, iter);
 }
 
 // Intrinsics functions
@@ -248,14 +280,7 @@ int mandel_do_tile_avx(int x, int y, int width, int height)
         zi       = y;
       }
 
-      cur_img(i, j + 0) = iteration_to_color(_mm256_extract_epi32(iter, 0));
-      cur_img(i, j + 1) = iteration_to_color(_mm256_extract_epi32(iter, 1));
-      cur_img(i, j + 2) = iteration_to_color(_mm256_extract_epi32(iter, 2));
-      cur_img(i, j + 3) = iteration_to_color(_mm256_extract_epi32(iter, 3));
-      cur_img(i, j + 4) = iteration_to_color(_mm256_extract_epi32(iter, 4));
-      cur_img(i, j + 5) = iteration_to_color(_mm256_extract_epi32(iter, 5));
-      cur_img(i, j + 6) = iteration_to_color(_mm256_extract_epi32(iter, 6));
-      cur_img(i, j + 7) = iteration_to_color(_mm256_extract_epi32(iter, 7));
+      _mm256_storeu_si256((__m256i *) &cur_img(i, j), colormap_lookup_avx(&palette, iter));
     }
 
   return 0;
@@ -431,6 +456,8 @@ static unsigned gpu_y_part;
 
 void mandel_init_ocl_hybrid (void)
 {
+  mandel_init ();
+
   if (GPU_TILE_H != TILE_H)
     exit_with_error ("CPU and GPU Tiles should have the same height (%d != %d)",
                      GPU_TILE_H, TILE_H);
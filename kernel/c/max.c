@@ -4,16 +4,20 @@
 #include <omp.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <string.h>
 
 // CAUTION: task_ids constants and string representation must be declared in the
 // same order
 enum
 {
   TASKID_DOWN_RIGHT,
-  TASKID_UP_LEFT
+  TASKID_UP_LEFT,
+  TASKID_ROW_SCAN,
+  TASKID_COLUMN_SCAN,
+  TASKID_TILE_FIXPOINT
 };
 
-static char *task_ids[] = {"Down Right Propagation", "Up Left Propagation", NULL};
+static char *task_ids[] = {"Down Right Propagation", "Up Left Propagation", "Row Scan", "Column Scan", "Tile Fixpoint", NULL};
 
 void max_init(void)
 {
@@ -312,6 +316,338 @@ unsigned max_compute_task(unsigned nb_iter)
   return res;
 }
 
+///////////////////////////// Parallel scan version (omp_scan)
+// Max colors are propagated along rows and columns. Within a row (resp.
+// column), non-zero pixels delimited by zeros form segments which all
+// receive the segment max: this is a segmented prefix-max scan in both
+// directions. Row scans are vectorized within rows, column scans across
+// columns.
+//
+// Each pass first brings every tile to a local fixed point, alternating row
+// and column scans restricted to the tile, so that winding paths are
+// followed while the tile is in cache. Colors then cross tiles through
+// scans along whole rows, then along whole columns. Tiles are independent
+// from each other, so are rows and columns: there is no wavefront.
+//
+// Tiles, horizontal bands and vertical bands are only processed again if
+// another phase modified them. The computation has converged when a column
+// phase leaves everything untouched.
+//
+// Suggested cmdline(s):
+// ./run -l images/spirale.png -k max -v omp_scan -ts 32 -m
+//
+
+static int tile_fixpoint(int x, int y, int w, int h);
+static int scan_row(int i, int x, int w, char *col_dirty, char *tile_dirty);
+static int scan_columns(int x, int w, int y, int h, char *row_dirty, char *tile_dirty);
+
+// Marks the band (or tile) containing a modified pixel as dirty, if dirty
+// flags are given. Several threads may store the same value concurrently.
+static inline void mark_dirty(char *dirty, int index)
+{
+  if (dirty != NULL)
+  {
+#pragma omp atomic write
+    dirty[index] = 1;
+  }
+}
+
+unsigned max_compute_omp_scan(unsigned nb_iter)
+{
+  char row_dirty[NB_TILES_Y];
+  char col_dirty[NB_TILES_X];
+  char tile_dirty[NB_TILES_Y][NB_TILES_X];
+
+  memset(row_dirty, 1, NB_TILES_Y);
+  memset(col_dirty, 1, NB_TILES_X);
+  memset(tile_dirty, 1, NB_TILES_Y * NB_TILES_X);
+
+  for (unsigned it = 1; it <= nb_iter; it++)
+  {
+#pragma omp parallel for collapse(2) schedule(runtime)
+    for (int ty = 0; ty < NB_TILES_Y; ty++)
+      for (int tx = 0; tx < NB_TILES_X; tx++)
+        if (tile_dirty[ty][tx])
+        {
+          tile_dirty[ty][tx] = 0;
+
+          monitoring_start_tile(omp_get_thread_num());
+
+          if (tile_fixpoint(tx * TILE_W, ty * TILE_H, TILE_W, TILE_H))
+          {
+            mark_dirty(row_dirty, ty);
+            mark_dirty(col_dirty, tx);
+          }
+
+          monitoring_end_tile_id(tx * TILE_W, ty * TILE_H, TILE_W, TILE_H, omp_get_thread_num(), TASKID_TILE_FIXPOINT);
+        }
+
+#pragma omp parallel for schedule(runtime)
+    for (int t = 0; t < NB_TILES_Y; t++)
+      if (row_dirty[t])
+      {
+        row_dirty[t] = 0;
+
+        monitoring_start_tile(omp_get_thread_num());
+
+        for (int i = t * TILE_H; i < (t + 1) * TILE_H; i++)
+          scan_row(i, 0, DIM, col_dirty, tile_dirty[t]);
+
+        monitoring_end_tile_id(0, t * TILE_H, DIM, TILE_H, omp_get_thread_num(), TASKID_ROW_SCAN);
+      }
+
+    int stable = 1;
+
+#pragma omp parallel for schedule(runtime) reduction(& : stable)
+    for (int t = 0; t < NB_TILES_X; t++)
+      if (col_dirty[t])
+      {
+        col_dirty[t] = 0;
+
+        monitoring_start_tile(omp_get_thread_num());
+
+        stable &= !scan_columns(t * TILE_W, TILE_W, 0, DIM, row_dirty, &tile_dirty[0][t]);
+
+        monitoring_end_tile_id(t * TILE_W, 0, TILE_W, DIM, omp_get_thread_num(), TASKID_COLUMN_SCAN);
+      }
+
+    if (stable)
+      return it;
+  }
+
+  return 0;
+}
+
+// Same as mark_dirty for a vector of pixels which may span several bands
+static inline void mark_dirty_vec(char *dirty, int j, int n)
+{
+  for (int t = j / TILE_W; t <= (j + n - 1) / TILE_W; t++)
+    mark_dirty(dirty, t);
+}
+
+#ifdef ENABLE_VECTO
+#if __AVX2__ == 1
+#define MAX_SCAN_AVX
+#endif
+#endif
+
+#ifdef MAX_SCAN_AVX
+
+#include <immintrin.h>
+
+// Shifts lanes of a by d positions towards higher (dir > 0) or lower
+// (dir < 0) lanes, filling with zeros
+static inline __m256i shift_lanes(__m256i a, int d, int dir)
+{
+  const __m256i lanes = _mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+  __m256i idx         = dir > 0 ? _mm256_sub_epi32(lanes, _mm256_set1_epi32(d)) : _mm256_add_epi32(lanes, _mm256_set1_epi32(d));
+  // Lanes whose source index is within [0..7]
+  __m256i valid = _mm256_cmpeq_epi32(_mm256_and_si256(idx, _mm256_set1_epi32(~7)), _mm256_setzero_si256());
+
+  return _mm256_and_si256(_mm256_permutevar8x32_epi32(a, idx), valid);
+}
+
+// Segmented max scan of 8 pixels in direction dir, continued from carry
+// (the running max broadcasted on all lanes). Zero pixels stay zero and
+// stop propagation.
+static inline __m256i scan_vector(__m256i v, __m256i *carry, int dir)
+{
+  __m256i stop = _mm256_cmpeq_epi32(v, _mm256_setzero_si256());
+
+  for (int d = 1; d < AVX_VEC_SIZE_INT; d *= 2)
+  {
+    __m256i m = _mm256_max_epu32(v, shift_lanes(v, d, dir));
+
+    v    = _mm256_blendv_epi8(m, v, stop);
+    stop = _mm256_or_si256(stop, shift_lanes(stop, d, dir));
+  }
+  // Lanes not preceded by a zero within the vector get the carry
+  v = _mm256_blendv_epi8(_mm256_max_epu32(v, *carry), v, stop);
+
+  *carry = _mm256_permutevar8x32_epi32(v, _mm256_set1_epi32(dir > 0 ? 7 : 0));
+
+  return v;
+}
+
+static inline int scan_row_vec(uint32_t *p, __m256i *carry, int dir)
+{
+  __m256i v = _mm256_loadu_si256((__m256i *) p);
+  __m256i r = scan_vector(v, carry, dir);
+
+  _mm256_storeu_si256((__m256i *) p, r);
+
+  return !_mm256_testz_si256(_mm256_xor_si256(v, r), _mm256_xor_si256(v, r));
+}
+
+#endif
+
+static inline int scan_pixel(uint32_t *p, uint32_t *carry)
+{
+  int change = 0;
+
+  if (*p)
+  {
+    if (*carry > *p)
+    {
+      *p     = *carry;
+      change = 1;
+    }
+    *carry = *p;
+  }
+  else
+    *carry = 0;
+
+  return change;
+}
+
+// Scans pixels [x..x+w-1] of row i in both directions. Dirty flags are
+// indexed by vertical band.
+static int scan_row(int i, int x, int w, char *col_dirty, char *tile_dirty)
+{
+  uint32_t *row  = &cur_img(i, 0);
+  uint32_t carry = 0;
+  int change     = 0;
+  int j;
+
+#ifdef MAX_SCAN_AVX
+  const int vec_end = x + w - w % AVX_VEC_SIZE_INT;
+  __m256i vcarry    = _mm256_setzero_si256();
+
+  // Left to right
+  for (j = x; j < vec_end; j += AVX_VEC_SIZE_INT)
+    if (scan_row_vec(row + j, &vcarry, 1))
+    {
+      change = 1;
+      mark_dirty_vec(col_dirty, j, AVX_VEC_SIZE_INT);
+      mark_dirty_vec(tile_dirty, j, AVX_VEC_SIZE_INT);
+    }
+  carry = _mm256_extract_epi32(vcarry, 0);
+#else
+  const int vec_end = x;
+#endif
+
+  for (j = vec_end; j < x + w; j++)
+    if (scan_pixel(row + j, &carry))
+    {
+      change = 1;
+      mark_dirty(col_dirty, j / TILE_W);
+      mark_dirty(tile_dirty, j / TILE_W);
+    }
+
+  // Right to left
+  carry = 0;
+  for (j = x + w - 1; j >= vec_end; j--)
+    if (scan_pixel(row + j, &carry))
+    {
+      change = 1;
+      mark_dirty(col_dirty, j / TILE_W);
+      mark_dirty(tile_dirty, j / TILE_W);
+    }
+
+#ifdef MAX_SCAN_AVX
+  vcarry = _mm256_set1_epi32(carry);
+  for (j = vec_end - AVX_VEC_SIZE_INT; j >= x; j -= AVX_VEC_SIZE_INT)
+    if (scan_row_vec(row + j, &vcarry, -1))
+    {
+      change = 1;
+      mark_dirty_vec(col_dirty, j, AVX_VEC_SIZE_INT);
+      mark_dirty_vec(tile_dirty, j, AVX_VEC_SIZE_INT);
+    }
+#endif
+
+  return change;
+}
+
+// Propagates the max color of cur_img (from, j) into cur_img (i, j),
+// unless the latter is zero. Returns 1 if the pixel changed.
+static inline int propagate_pixel(int i, int j, int from)
+{
+  uint32_t c = cur_img(i, j);
+  uint32_t m = cur_img(from, j);
+
+  if (c && m > c)
+  {
+    cur_img(i, j) = m;
+    return 1;
+  }
+  return 0;
+}
+
+#ifdef MAX_SCAN_AVX
+static inline int propagate_vec(int i, int j, int from)
+{
+  __m256i c = _mm256_loadu_si256((__m256i *) &cur_img(i, j));
+  __m256i m = _mm256_max_epu32(c, _mm256_loadu_si256((__m256i *) &cur_img(from, j)));
+
+  m = _mm256_blendv_epi8(m, c, _mm256_cmpeq_epi32(c, _mm256_setzero_si256()));
+  _mm256_storeu_si256((__m256i *) &cur_img(i, j), m);
+
+  return !_mm256_testz_si256(_mm256_xor_si256(c, m), _mm256_xor_si256(c, m));
+}
+#endif
+
+// Propagates row from into row i, for columns [x..x+w-1]
+static inline int propagate_row(int i, int from, int x, int w)
+{
+  int change = 0;
+  int j      = x;
+
+#ifdef MAX_SCAN_AVX
+  for (; j + AVX_VEC_SIZE_INT <= x + w; j += AVX_VEC_SIZE_INT)
+    change |= propagate_vec(i, j, from);
+#endif
+  for (; j < x + w; j++)
+    change |= propagate_pixel(i, j, from);
+
+  return change;
+}
+
+// Scans columns [x..x+w-1] over rows [y..y+h-1] in both directions. Dirty
+// flags are indexed by horizontal band: tile_dirty points to the flag of
+// the first tile of the vertical band, flags of a band being NB_TILES_X
+// apart.
+static int scan_columns(int x, int w, int y, int h, char *row_dirty, char *tile_dirty)
+{
+  int change = 0;
+
+  // Top to bottom
+  for (int i = y + 1; i < y + h; i++)
+    if (propagate_row(i, i - 1, x, w))
+    {
+      change = 1;
+      mark_dirty(row_dirty, i / TILE_H);
+      mark_dirty(tile_dirty, (i / TILE_H) * NB_TILES_X);
+    }
+
+  // Bottom to top
+  for (int i = y + h - 2; i >= y; i--)
+    if (propagate_row(i, i + 1, x, w))
+    {
+      change = 1;
+      mark_dirty(row_dirty, i / TILE_H);
+      mark_dirty(tile_dirty, (i / TILE_H) * NB_TILES_X);
+    }
+
+  return change;
+}
+
+// Brings a tile to a local fixed point, ignoring neighbor tiles
+static int tile_fixpoint(int x, int y, int w, int h)
+{
+  int change = 0;
+
+  for (;;)
+  {
+    for (int i = y; i < y + h; i++)
+      change |= scan_row(i, x, w, NULL, NULL);
+
+    if (!scan_columns(x, w, y, h, NULL, NULL))
+      return change;
+
+    change = 1;
+  }
+}
+
 ///////////////////////////// Drawing functions
 
 static void spiral(unsigned twists);
@@ -44,6 +44,13 @@ void pixelize_config(char *param)
   }
 }
 
+// Can be used as a pipeline stage (e.g. -k blur+pixelize)
+void pixelize_pipeline_stage(pipeline_stage_t *stage)
+{
+  stage->kind = PIPELINE_BLOCK;
+  stage->size = PIX_BLOC;
+}
+
 // Tile computation
 int pixelize_do_tile_default(int x, int y, int width, int height)
 {
@@ -134,3 +141,48 @@ void pixelize_init_ocl(void)
   if (GPU_TILE_W < PIX_BLOC || (GPU_TILE_W % PIX_BLOC != 0))
     exit_with_error("Tile size (%d) must be a multiple of PIX_BLOC (%d)", GPU_TILE_W, PIX_BLOC);
 }
+
+///////////////////////////// Summed-area table version (sat)
+// The summed-area tables of the image are built once (in parallel), then
+// each block is filled with a mean that costs four lookups per channel.
+// Suggested cmdline:
+// ./run -l images/1024.png -k pixelize -v sat -a 16
+//
+static sat_t sat;
+
+void pixelize_init_sat(void)
+{
+  sat_init(&sat);
+}
+
+void pixelize_finalize_sat(void)
+{
+  sat_free(&sat);
+}
+
+unsigned pixelize_compute_sat(unsigned nb_iter)
+{
+  for (unsigned it = 1; it <= nb_iter; it++)
+  {
+    sat_build(&sat, image);
+
+#pragma omp parallel for collapse(2) schedule(runtime)
+    for (int y = 0; y < DIM; y += PIX_BLOC)
+      for (int x = 0; x < DIM; x += PIX_BLOC)
+      {
+        const int x1 = min(x + PIX_BLOC, DIM), y1 = min(y + PIX_BLOC, DIM);
+        uint32_t mean;
+
+        monitoring_start_tile(omp_get_thread_num());
+
+        mean = sat_box_mean(&sat, x, y, x1, y1);
+        for (int i = y; i < y1; i++)
+          for (int j = x; j < x1; j++)
+            cur_img(i, j) = mean;
+
+        monitoring_end_tile(x, y, x1 - x, y1 - y, omp_get_thread_num());
+      }
+  }
+
+  return 0;
+}
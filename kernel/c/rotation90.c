@@ -4,6 +4,13 @@
 #include <omp.h>
 #include <stdbool.h>
 
+// Four successive rotations give back the original image: iterations can be folded
+// (see --fold-iterations)
+unsigned rotation90_period(void)
+{
+  return 4;
+}
+
 // Tile computation
 int rotation90_do_tile_default(int x, int y, int width, int height)
 {
@@ -13,6 +20,23 @@ int rotation90_do_tile_default(int x, int y, int width, int height)
   return 0;
 }
 
+// Recursive blocking down to 8x8 blocks transposed in registers
+// Suggested cmdline:
+// ./run -l images/shibuya.png -k rotation90 -v omp_tiled -ts 256 -wt rec
+//
+int rotation90_do_tile_rec(int x, int y, int width, int height)
+{
+  img_transpose_block(alt_image, image, x, y, width, height, TRANSPOSE_FLIP_ROWS);
+  return 0;
+}
+
+// Same, using non-temporal stores for the destination
+int rotation90_do_tile_rec_nt(int x, int y, int width, int height)
+{
+  img_transpose_block(alt_image, image, x, y, width, height, TRANSPOSE_FLIP_ROWS | TRANSPOSE_STREAM);
+  return 0;
+}
+
 ///////////////////////////// Simple sequential version (seq)
 // Suggested cmdline:
 // ./run --load-image images/shibuya.png --kernel rotation90 --pause
@@ -37,27 +37,49 @@ static inline void swap_tables()
 
 static TYPE max_grains;
 
+// Grain counts up to max_grains are colored through a palette which is
+// only rebuilt when max_grains changes. Very large piles are not worth a
+// huge table: counts above GRAINS_PALETTE_MAX use the formula directly.
+#define GRAINS_PALETTE_MAX 65536
+
+static colormap_t grains_palette;
+static TYPE palette_max_grains;
+
+static uint32_t grains_to_color(unsigned g, unsigned size)
+{
+  int r, v, b;
+  r = v = b = 0;
+  if (g == 1)
+    v = 255;
+  else if (g == 2)
+    b = 255;
+  else if (g == 3)
+    r = 255;
+  else if (g == 4)
+    r = v = b = 255;
+  else if (g > 4)
+    r = b = 255 - (240 * ((double) g) / (double) max_grains);
+
+  return RGB(r, v, b);
+}
+
 void asandPile_refresh_img()
 {
   unsigned long int max = 0;
+
+  if (grains_palette.colors == NULL || palette_max_grains != max_grains)
+  {
+    colormap_free(&grains_palette);
+    colormap_init_func(&grains_palette, min(max_grains, GRAINS_PALETTE_MAX) + 1, grains_to_color);
+    palette_max_grains = max_grains;
+  }
+
   for (int i = 1; i < DIM - 1; i++)
     for (int j = 1; j < DIM - 1; j++)
     {
-      int g = table(in, i, j);
-      int r, v, b;
-      r = v = b = 0;
-      if (g == 1)
-        v = 255;
-      else if (g == 2)
-        b = 255;
-      else if (g == 3)
-        r = 255;
-      else if (g == 4)
-        r = v = b = 255;
-      else if (g > 4)
-        r = b = 255 - (240 * ((double) g) / (double) max_grains);
-
-      cur_img(i, j) = RGB(r, v, b);
+      TYPE g = table(in, i, j);
+
+      cur_img(i, j) = g < grains_palette.size ? grains_palette.colors[g] : grains_to_color(g, 0);
       if (g > max)
         max = g;
     }
@@ -189,6 +211,7 @@ void ssandPile_init()
 void ssandPile_finalize()
 {
   free(TABLE);
+  colormap_free(&grains_palette);
 }
 
 int ssandPile_do_tile_default(int x, int y, int width, int height)
@@ -279,6 +302,7 @@ void asandPile_finalize()
   const unsigned size = DIM * DIM * sizeof(TYPE);
 
   munmap(TABLE, size);
+  colormap_free(&grains_palette);
 }
 
 ///////////////////////////// Version séquentielle simple (seq)
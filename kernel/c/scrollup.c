@@ -81,6 +81,25 @@ unsigned scrollup_compute_ji(unsigned nb_iter)
   return 0;
 }
 
+///////////////////////////// Ring buffer version (ring)
+// The image is mapped twice back-to-back in virtual memory, so scrolling
+// only moves the image pointer by one row: no pixel is copied.
+// Suggested cmdline(s):
+// ./run -l images/1024.png -k scrollup -v ring
+//
+void scrollup_init_ring(void)
+{
+  img_data_use_ring_buffer();
+}
+
+unsigned scrollup_compute_ring(unsigned nb_iter)
+{
+  for (unsigned it = 1; it <= nb_iter; it++)
+    img_data_scroll(1);
+
+  return 0;
+}
+
 //////////// OpenCL version using mask (ocl_ouf)
 // Suggested cmdlines:
 // ./run -l images/shibuya.png -k scrollup -o -v ocl_ouf
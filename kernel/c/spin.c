@@ -3,9 +3,15 @@
 
 #include <math.h>
 #include <omp.h>
+#include <string.h>
+
+#include "vec_aligned_alloc.h"
 
 static void rotate(void);
 static unsigned compute_color(int i, int j);
+static void build_angle_table(void);
+
+static float *angle_table = NULL;
 
 // If defined, the initialization hook function is called quite early in the
 // initialization process, after the size (DIM variable) of images is known.
@@ -21,6 +27,19 @@ void spin_init(void)
   PRINT_DEBUG('u', "Image size is %dx%d\n", DIM, DIM);
   PRINT_DEBUG('u', "Block size is %dx%d\n", TILE_W, TILE_H);
   PRINT_DEBUG('u', "Press <SPACE> to pause/unpause, <ESC> to quit.\n");
+
+  // The "lut" tile functions only read precomputed angles
+  if (!strncmp(tile_name, "lut", 3))
+    build_angle_table();
+}
+
+void spin_finalize(void)
+{
+  if (angle_table != NULL)
+  {
+    vec_aligned_free(angle_table);
+    angle_table = NULL;
+  }
 }
 
 // The image is a two-dimension array of size of DIM x DIM. Each pixel is of
@@ -171,6 +190,55 @@ static void rotate(void)
   base_angle = fmodf(base_angle + (1.0 / 180.0) * M_PI, M_PI);
 }
 
+/////////////// Precomputed angles
+
+// The angle of a pixel relative to the center never changes: only base_angle
+// does. We store (atan2 + π) expressed in units of π/4, so that each
+// iteration only needs an addition and a fractional part:
+//   ratio = |fmodf (angle, π/4) / (π/8) - 1| = |2 * frac (t + base * 4/π) - 1|
+
+#define angle_cell(y, x) (angle_table[(y) * DIM + (x)])
+
+static void build_angle_table(void)
+{
+  angle_table = vec_aligned_malloc(DIM * DIM * sizeof(float));
+
+#pragma omp parallel for schedule(static)
+  for (int i = 0; i < DIM; i++)
+    for (int j = 0; j < DIM; j++)
+      angle_cell(i, j) = (atan2f_approx((int) DIM / 2 - i, j - (int) DIM / 2) + M_PI) * (float) (4.0 / M_PI);
+}
+
+static inline float base_offset(void)
+{
+  return base_angle * (float) (4.0 / M_PI);
+}
+
+// Tile computation using the angle table
+// Suggested cmdline(s):
+// ./run -k spin -v omp_tiled -wt lut -ts 64
+//
+int spin_do_tile_lut(int x, int y, int width, int height)
+{
+  const float offset = base_offset();
+
+  for (int i = y; i < y + height; i++)
+    for (int j = x; j < x + width; j++)
+    {
+      float t     = angle_cell(i, j) + offset;
+      float ratio = fabsf(2.0f * (t - floorf(t)) - 1.0f);
+
+      int r = color_a_r * ratio + color_b_r * (1.0 - ratio);
+      int g = color_a_g * ratio + color_b_g * (1.0 - ratio);
+      int b = color_a_b * ratio + color_b_b * (1.0 - ratio);
+      int a = color_a_a * ratio + color_b_a * (1.0 - ratio);
+
+      cur_img(i, j) = rgba(r, g, b, a);
+    }
+
+  return 0;
+}
+
 // Intrinsics functions
 #ifdef ENABLE_VECTO
 
@@ -343,5 +411,53 @@ int spin_do_tile_avx(int x, int y, int width, int height)
   return 0;
 }
 
+void spin_tile_check_lut_avx(void)
+{
+  easypap_vec_check(AVX_VEC_SIZE_INT, DIR_HORIZONTAL);
+}
+
+// Same as spin_do_tile_lut, 8 pixels at a time
+// Suggested cmdline(s):
+// ./run -k spin -v omp_tiled -wt lut_avx -ts 64
+//
+int spin_do_tile_lut_avx(int x, int y, int width, int height)
+{
+  __m256 one    = _mm256_set1_ps(1.0);
+  __m256 two    = _mm256_set1_ps(2.0);
+  __m256 offset = _mm256_set1_ps(base_offset());
+
+  __m256 col_a_r = _mm256_set1_ps(color_a_r), col_b_r = _mm256_set1_ps(color_b_r);
+  __m256 col_a_g = _mm256_set1_ps(color_a_g), col_b_g = _mm256_set1_ps(color_b_g);
+  __m256 col_a_b = _mm256_set1_ps(color_a_b), col_b_b = _mm256_set1_ps(color_b_b);
+  __m256 col_a_a = _mm256_set1_ps(color_a_a), col_b_a = _mm256_set1_ps(color_b_a);
+
+  for (int i = y; i < y + height; i++)
+    for (int j = x; j < x + width; j += AVX_VEC_SIZE_FLOAT)
+    {
+      __m256 t = _mm256_add_ps(_mm256_loadu_ps(&angle_cell(i, j)), offset);
+
+      // ratio = |2 * (t - floor (t)) - 1|
+      __m256 ratio = _mm256_sub_ps(t, _mm256_floor_ps(t));
+      ratio        = _mm256_abs_ps(_mm256_fmsub_ps(ratio, two, one));
+
+      __m256 ratiocompl = _mm256_sub_ps(one, ratio);
+
+      __m256 red   = _mm256_fmadd_ps(col_b_r, ratiocompl, _mm256_mul_ps(col_a_r, ratio));
+      __m256 green = _mm256_fmadd_ps(col_b_g, ratiocompl, _mm256_mul_ps(col_a_g, ratio));
+      __m256 blue  = _mm256_fmadd_ps(col_b_b, ratiocompl, _mm256_mul_ps(col_a_b, ratio));
+      __m256 alpha = _mm256_fmadd_ps(col_b_a, ratiocompl, _mm256_mul_ps(col_a_a, ratio));
+
+      __m256i color = _mm256_cvtps_epi32(alpha);
+
+      color = _mm256_or_si256(color, _mm256_slli_epi32(_mm256_cvtps_epi32(blue), 8));
+      color = _mm256_or_si256(color, _mm256_slli_epi32(_mm256_cvtps_epi32(green), 16));
+      color = _mm256_or_si256(color, _mm256_slli_epi32(_mm256_cvtps_epi32(red), 24));
+
+      _mm256_storeu_si256((__m256i *) &cur_img(i, j), color);
+    }
+
+  return 0;
+}
+
 #endif
 #endif
@@ -1,6 +1,8 @@
 
 #include "easypap.h"
 
+#include <omp.h>
+
 unsigned MASK = 1;
 
 // The stripes kernel aims at highlighting the behavior of a GPU kernel in the
@@ -80,6 +82,91 @@ unsigned stripes_compute_seq(unsigned nb_iter)
   return 0;
 }
 
+///////////////////////////// Streaming parallel version (stream)
+// Both stripe colors are computed for 8 pixels at once with AVX2 and
+// blended according to the column mask (like a GPU would do in the
+// presence of divergence), unless the 8 pixels all fall in the same
+// stripe. Results are streamed into alt_image when the images exceed the
+// last level cache (see invert).
+// Suggested cmdline(s):
+// OMP_NUM_THREADS=4 ./run -l images/1024.png -k stripes -v stream -a 4
+//
+static uint32_t stripes_pixel(uint32_t c, int i, int j)
+{
+  return (j & MASK) ? brighten(c) : darken(c);
+}
+
+#ifdef POINTWISE_AVX
+
+// c * percentage / 100, saturated to 255. Products never exceed 255 * 101,
+// for which x / 100 == (x * 5243) >> 19.
+static inline __m256i scale_component_avx(__m256i c, __m256i percentage)
+{
+  __m256i x = _mm256_mullo_epi32(c, percentage);
+
+  x = _mm256_srli_epi32(_mm256_mullo_epi32(x, _mm256_set1_epi32(5243)), 19);
+
+  return _mm256_min_epu32(x, _mm256_set1_epi32(255));
+}
+
+static inline __m256i scale_15_avx(__m256i c, unsigned percentage)
+{
+  const __m256i p    = _mm256_set1_epi32(percentage);
+  const __m256i mask = _mm256_set1_epi32(255);
+  __m256i r          = _mm256_srli_epi32(c, 24);
+  __m256i g          = _mm256_and_si256(_mm256_srli_epi32(c, 16), mask);
+  __m256i b          = _mm256_and_si256(_mm256_srli_epi32(c, 8), mask);
+
+  for (int i = 0; i < 15; i++)
+  {
+    r = scale_component_avx(r, p);
+    g = scale_component_avx(g, p);
+    b = scale_component_avx(b, p);
+  }
+
+  return _mm256_or_si256(_mm256_or_si256(_mm256_slli_epi32(r, 24), _mm256_slli_epi32(g, 16)),
+                         _mm256_or_si256(_mm256_slli_epi32(b, 8), _mm256_and_si256(c, mask)));
+}
+
+static __m256i stripes_pixel_avx(__m256i c, int i, int j)
+{
+  // Uniform stripe over the 8 pixels
+  if (MASK >= 8)
+    return scale_15_avx(c, (j & MASK) ? 101 : 99);
+
+  __m256i cols = _mm256_add_epi32(_mm256_set1_epi32(j), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+  __m256i dark = _mm256_cmpeq_epi32(_mm256_and_si256(cols, _mm256_set1_epi32(MASK)), _mm256_setzero_si256());
+
+  return _mm256_blendv_epi8(scale_15_avx(c, 101), scale_15_avx(c, 99), dark);
+}
+
+#endif
+
+unsigned stripes_compute_stream(unsigned nb_iter)
+{
+  uint32_t *dst = pointwise_use_streaming() ? alt_image : image;
+
+  for (unsigned it = 1; it <= nb_iter; it++)
+  {
+#pragma omp parallel
+    {
+#ifdef POINTWISE_AVX
+      pointwise_map_avx(dst, image, stripes_pixel, stripes_pixel_avx);
+#else
+      pointwise_map(dst, image, stripes_pixel);
+#endif
+    }
+
+    if (dst != image)
+    {
+      swap_images();
+      dst = alt_image;
+    }
+  }
+
+  return 0;
+}
+
 ///////////////////////////// OpenCL version (ocl)
 // Suggested cmdline(s):
 // TILEY=2 TILEX=128 ./run -l images/1024.png -k stripes -o -a 2
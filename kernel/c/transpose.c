@@ -3,6 +3,13 @@
 
 #include <omp.h>
 
+// Transposing twice gives back the original image: iterations can be folded
+// (see --fold-iterations)
+unsigned transpose_period(void)
+{
+  return 2;
+}
+
 // Tile inner computation
 int transpose_do_tile_default(int x, int y, int width, int height)
 {
@@ -13,6 +20,23 @@ int transpose_do_tile_default(int x, int y, int width, int height)
   return 0;
 }
 
+// Recursive blocking down to 8x8 blocks transposed in registers
+int transpose_do_tile_rec(int x, int y, int width, int height)
+{
+  img_transpose_block(alt_image, image, x, y, width, height, 0);
+
+  return 0;
+}
+
+// Same, using non-temporal stores so that the destination does not evict
+// the source from caches
+int transpose_do_tile_rec_nt(int x, int y, int width, int height)
+{
+  img_transpose_block(alt_image, image, x, y, width, height, TRANSPOSE_STREAM);
+
+  return 0;
+}
+
 ///////////////////////////// Simple sequential version (seq)
 // Suggested cmdline:
 // ./run --load-image images/shibuya.png --kernel transpose --pause
@@ -46,3 +70,22 @@ unsigned transpose_compute_tiled(unsigned nb_iter)
 
   return 0;
 }
+
+///////////////////////////// Tiled parallel version (omp_tiled)
+// Suggested cmdline:
+// ./run -l images/shibuya.png -k transpose -v omp_tiled -ts 256 -wt rec_nt
+//
+unsigned transpose_compute_omp_tiled(unsigned nb_iter)
+{
+  for (unsigned it = 1; it <= nb_iter; it++)
+  {
+#pragma omp parallel for schedule(runtime) collapse(2)
+    for (int y = 0; y < DIM; y += TILE_H)
+      for (int x = 0; x < DIM; x += TILE_W)
+        do_tile(x, y, TILE_W, TILE_H, omp_get_thread_num());
+
+    swap_images();
+  }
+
+  return 0;
+}
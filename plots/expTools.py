@@ -14,9 +14,13 @@ def iterateur_option(dicopt):
         yield ' '.join(value)
 
 
-def execute(commande, ompenv, option, nbrun=1, verbose=True, easyPath='.'):
+# With bench > 0, each run is repeated in-process (--bench) after warmup
+# untimed runs, and statistics are added to the output file
+def execute(commande, ompenv, option, nbrun=1, verbose=True, easyPath='.', bench=0, warmup=0):
     path = os.getcwd()
     os.chdir(easyPath)
+    if bench > 0:
+        commande += " --bench " + str(bench) + " --warmup " + str(warmup)
     for i in range(nbrun):
         for omp in iterateur_option(ompenv):
             for opt in iterateur_option(option):
@@ -10,12 +10,20 @@ import textwrap
 from matplotlib.backends.backend_pdf import PdfPages
 
 
+# Columns added by --bench runs (time is then the median)
+benchCols = ['runs', 'min', 'median', 'mean', 'stddev', 'ci95']
+# Columns added by --perf-counters runs
+counterCols = ['cycles', 'instructions', 'llc_misses', 'branch_misses']
+
+
 def openfile(path="./plots/data/perf_data.csv", sepa=";"):
     try:
-        return pds.read_csv(path, sep=sepa)
+        df = pds.read_csv(path, sep=sepa)
     except FileNotFoundError:
         print("File not found: ", path, file=sys.stderr)
         sys.exit(1)
+    # Statistics and counters must not be considered as experiment parameters
+    return df.drop(columns=[c for c in benchCols + counterCols if c in df.columns])
 
 # Donne tous les champs de df qui ne sont pas lists
 
@@ -1,8 +1,8 @@
 #!/usr/bin/env bash
 
 TRACEDIR=${TRACEDIR:-${EASYPAPDIR}/traces/data}
-TRACEFILE=${TRACEDIR}/ezv_trace_current.evt
-OLDTRACEFILE=${TRACEDIR}/ezv_trace_previous.evt
+TRACEFILE=${TRACEDIR}/ezv_trace_current.ezt
+OLDTRACEFILE=${TRACEDIR}/ezv_trace_previous.ezt
 
 SIMU=${EASYPAPDIR}/bin/easypap
 VIEW=${EASYPAPDIR}/traces/bin/easyview
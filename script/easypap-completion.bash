@@ -238,9 +238,9 @@ _easyview_completions()
     else
         compopt -o filenames
         if [[ -z "$cur" ]]; then
-            COMPREPLY=($(compgen -f -X '!*.evt' -- ${tracedir}/))
+            COMPREPLY=($(compgen -f -X '!*.@(ezt|evt)' -- ${tracedir}/))
         else
-            COMPREPLY=($(compgen -o plusdirs -f -X '!*.evt' -- $cur))
+            COMPREPLY=($(compgen -o plusdirs -f -X '!*.@(ezt|evt)' -- $cur))
         fi
     fi
 }
@@ -0,0 +1,226 @@
+#include <errno.h>
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/utsname.h>
+
+#include "api_funcs.h"
+#include "autotune.h"
+#include "debug.h"
+#include "error.h"
+#include "global.h"
+
+// Tile sides are divisors of DIM in [MIN_TILE..MAX_TILE], preferably
+// multiples of 8 (vectorization), and tiles cannot be longer than
+// MAX_RATIO times their width (or the converse)
+#define MIN_TILE 8
+#define MAX_TILE 512
+#define MAX_RATIO 4
+
+// Iterations per candidate stop doubling after this factor
+#define MAX_GROWTH 16
+
+#define MAX_SIDES 32
+#define MAX_LINE 1024
+
+static char *schedules[] = {"static", "dynamic", "guided"};
+
+#define NB_SCHEDULES (sizeof (schedules) / sizeof (schedules[0]))
+
+typedef struct
+{
+  autotune_config_t cfg;
+  double time;
+} candidate_t;
+
+static int find_sides (unsigned sides[], unsigned multiple)
+{
+  int n = 0;
+
+  for (unsigned d = 1; d <= DIM && d <= MAX_TILE && n < MAX_SIDES; d++)
+    if (DIM % d == 0 && d % multiple == 0 && (d >= MIN_TILE || d == DIM))
+      sides[n++] = d;
+
+  return n;
+}
+
+static candidate_t *make_candidates (int *nb, autotune_valid_func_t valid)
+{
+  unsigned sides[MAX_SIDES];
+  int nb_sides = find_sides (sides, 8);
+  candidate_t *cand;
+  int n = 0;
+
+  if (nb_sides == 0)
+    nb_sides = find_sides (sides, 1);
+  if (nb_sides == 0)
+    exit_with_error ("No tile size to explore for DIM = %d", DIM);
+
+  cand = malloc (nb_sides * nb_sides * NB_SCHEDULES * sizeof (candidate_t));
+  if (cand == NULL)
+    exit_with_error ("Cannot allocate autotuning candidates");
+
+  for (int i = 0; i < nb_sides; i++)
+    for (int j = 0; j < nb_sides; j++) {
+      unsigned w = sides[j], h = sides[i];
+      autotune_config_t cfg = {w, h, ""};
+
+      if (w > h * MAX_RATIO || h > w * MAX_RATIO)
+        continue;
+
+      if (!valid (&cfg)) {
+        PRINT_DEBUG ('u', "Autotune: %dx%d tiles rejected by kernel\n", w, h);
+        continue;
+      }
+
+      for (unsigned s = 0; s < NB_SCHEDULES; s++) {
+        cand[n].cfg = cfg;
+        strcpy (cand[n].cfg.schedule, schedules[s]);
+        n++;
+      }
+    }
+
+  if (n == 0)
+    exit_with_error ("No tile size accepted by kernel [%s] for DIM = %d",
+                     kernel_name, DIM);
+
+  *nb = n;
+  return cand;
+}
+
+static int compare_candidates (const void *a, const void *b)
+{
+  double x = ((const candidate_t *)a)->time, y = ((const candidate_t *)b)->time;
+
+  return (x > y) - (x < y);
+}
+
+void autotune_search (autotune_config_t *best, unsigned first_iter,
+                      autotune_valid_func_t valid,
+                      autotune_measure_func_t measure)
+{
+  int n;
+  candidate_t *cand = make_candidates (&n, valid);
+  unsigned nb_iter;
+
+  if (first_iter == 0)
+    first_iter = 1;
+  nb_iter = first_iter;
+
+  for (int round = 1; n > 1; round++) {
+    PRINT_MASTER ("Autotune round %d: %d configurations, %u iteration(s)\n",
+                  round, n, nb_iter);
+
+    for (int c = 0; c < n; c++) {
+      cand[c].time = measure (&cand[c].cfg, nb_iter);
+
+      PRINT_DEBUG ('u', "Autotune: %dx%d %s: %.1f us/iter\n",
+                   cand[c].cfg.tile_w, cand[c].cfg.tile_h,
+                   cand[c].cfg.schedule, cand[c].time);
+    }
+
+    // Keep the fastest half
+    qsort (cand, n, sizeof (candidate_t), compare_candidates);
+    n = (n + 1) / 2;
+    if (nb_iter < first_iter * MAX_GROWTH)
+      nb_iter *= 2;
+  }
+
+  *best = cand[0].cfg;
+
+  free (cand);
+}
+
+void autotune_apply_schedule (char *schedule)
+{
+  omp_sched_t kind;
+  char *comma = strchr (schedule, ',');
+  int chunk   = comma ? atoi (comma + 1) : 0;
+
+  if (!strncmp (schedule, "static", 6))
+    kind = omp_sched_static;
+  else if (!strncmp (schedule, "dynamic", 7))
+    kind = omp_sched_dynamic;
+  else if (!strncmp (schedule, "guided", 6))
+    kind = omp_sched_guided;
+  else if (!strncmp (schedule, "auto", 4))
+    kind = omp_sched_auto;
+  else
+    exit_with_error ("Unknown schedule policy (%s)", schedule);
+
+  omp_set_schedule (kind, chunk);
+  setenv ("OMP_SCHEDULE", schedule, 1);
+}
+
+static void make_key (char *key, int size)
+{
+  struct utsname s;
+
+  if (uname (&s) < 0)
+    exit_with_error ("uname failed (%s)", strerror (errno));
+
+  snprintf (key, size, "%s;%s;%s;%s;%u;%u;", s.nodename, kernel_name,
+            variant_name, tile_name, DIM,
+            easypap_requested_number_of_threads ());
+}
+
+int autotune_cache_lookup (char *filename, autotune_config_t *cfg)
+{
+  char key[MAX_LINE], line[MAX_LINE];
+  FILE *f = fopen (filename, "r");
+  int found = 0;
+
+  if (f == NULL)
+    return 0;
+
+  make_key (key, MAX_LINE);
+
+  // The last matching line wins
+  while (fgets (line, MAX_LINE, f) != NULL)
+    if (!strncmp (line, key, strlen (key))) {
+      autotune_config_t c;
+
+      if (sscanf (line + strlen (key), "%u;%u;%31[^;\n]", &c.tile_w,
+                  &c.tile_h, c.schedule) == 3) {
+        *cfg  = c;
+        found = 1;
+      }
+    }
+
+  fclose (f);
+  return found;
+}
+
+void autotune_cache_store (char *filename, autotune_config_t *cfg)
+{
+  char key[MAX_LINE], line[MAX_LINE], tmp[MAX_LINE];
+  FILE *f, *out;
+
+  make_key (key, MAX_LINE);
+
+  snprintf (tmp, MAX_LINE, "%s.tmp", filename);
+  out = fopen (tmp, "w");
+  if (out == NULL)
+    exit_with_error ("Cannot open \"%s\" file (%s)", tmp, strerror (errno));
+
+  fprintf (out, "machine;kernel;variant;tiling;size;threads;tilew;tileh;"
+                "schedule\n");
+
+  // Copy previous entries, except the one being replaced
+  f = fopen (filename, "r");
+  if (f != NULL) {
+    if (fgets (line, MAX_LINE, f) != NULL) // skip header
+      while (fgets (line, MAX_LINE, f) != NULL)
+        if (strncmp (line, key, strlen (key)))
+          fputs (line, out);
+    fclose (f);
+  }
+
+  fprintf (out, "%s%u;%u;%s\n", key, cfg->tile_w, cfg->tile_h, cfg->schedule);
+  fclose (out);
+
+  if (rename (tmp, filename) < 0)
+    exit_with_error ("Cannot rename \"%s\" into \"%s\" (%s)", tmp, filename,
+                     strerror (errno));
+}
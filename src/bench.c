@@ -0,0 +1,46 @@
+#include <math.h>
+#include <stdlib.h>
+
+#include "bench.h"
+
+// Two-sided 97.5% quantiles of Student's t distribution, for 1 to 30
+// degrees of freedom
+static const double student_t[] = {
+    12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+    2.201,  2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+    2.080,  2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+
+#define NB_STUDENT_T (sizeof (student_t) / sizeof (student_t[0]))
+
+static int compare_long (const void *a, const void *b)
+{
+  long x = *(const long *)a, y = *(const long *)b;
+
+  return (x > y) - (x < y);
+}
+
+void bench_compute_stats (long *samples, unsigned n, bench_stats_t *stats)
+{
+  double sum = 0.0, sq = 0.0;
+
+  qsort (samples, n, sizeof (long), compare_long);
+
+  stats->runs   = n;
+  stats->min    = samples[0];
+  stats->median = (n % 2) ? samples[n / 2]
+                          : (samples[n / 2 - 1] + samples[n / 2]) / 2;
+
+  for (unsigned i = 0; i < n; i++)
+    sum += samples[i];
+  stats->mean = sum / n;
+
+  for (unsigned i = 0; i < n; i++)
+    sq += (samples[i] - stats->mean) * (samples[i] - stats->mean);
+  stats->stddev = (n > 1) ? sqrt (sq / (n - 1)) : 0.0;
+
+  if (n > 1) {
+    double t = (n - 1 <= NB_STUDENT_T) ? student_t[n - 2] : 1.960;
+    stats->ci95 = t * stats->stddev / sqrt (n);
+  } else
+    stats->ci95 = 0.0;
+}
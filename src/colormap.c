@@ -0,0 +1,65 @@
+#include <stdlib.h>
+
+#include "colormap.h"
+#include "error.h"
+#include "img_data.h"
+#include "vec_aligned_alloc.h"
+
+void colormap_init_func (colormap_t *cm, unsigned size,
+                         uint32_t (*f) (unsigned index, unsigned size))
+{
+  if (size == 0)
+    exit_with_error ("Colormap size must be greater than zero");
+
+  cm->size   = size;
+  cm->colors = vec_aligned_malloc (size * sizeof (uint32_t));
+
+  for (unsigned i = 0; i < size; i++)
+    cm->colors[i] = f (i, size);
+}
+
+static float normalized (unsigned index, unsigned size)
+{
+  return size > 1 ? (float)index / (float)(size - 1) : 0.0;
+}
+
+static uint32_t heat_entry (unsigned index, unsigned size)
+{
+  return heat_to_rgb (normalized (index, size));
+}
+
+static uint32_t gauss_entry (unsigned index, unsigned size)
+{
+  return heat_to_3gauss_rgb (normalized (index, size));
+}
+
+void colormap_init_heat (colormap_t *cm, unsigned size)
+{
+  colormap_init_func (cm, size, heat_entry);
+}
+
+void colormap_init_3gauss (colormap_t *cm, unsigned size)
+{
+  colormap_init_func (cm, size, gauss_entry);
+}
+
+void colormap_init_hsv (colormap_t *cm, unsigned size, float s, float v)
+{
+  if (size == 0)
+    exit_with_error ("Colormap size must be greater than zero");
+
+  cm->size   = size;
+  cm->colors = vec_aligned_malloc (size * sizeof (uint32_t));
+
+  for (unsigned i = 0; i < size; i++)
+    cm->colors[i] = hsv_to_rgb ((float)i / (float)size, s, v);
+}
+
+void colormap_free (colormap_t *cm)
+{
+  if (cm->colors != NULL) {
+    vec_aligned_free (cm->colors);
+    cm->colors = NULL;
+  }
+  cm->size = 0;
+}
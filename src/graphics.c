@@ -141,6 +141,12 @@ static SDL_Surface *more_recent_surface (void)
       break;
     }
 
+  // The image pointer may have moved (e.g. ring buffer mode)
+  if (s == NULL) {
+    s         = surface[0];
+    s->pixels = image;
+  }
+
   return s;
 }
 
@@ -3,10 +3,12 @@
 #include "error.h"
 #include "global.h"
 #include "ocl.h"
+#include "pipeline.h"
 
 #include <dlfcn.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #ifdef __APPLE__
 #define DLSYM_FLAG RTLD_SELF
@@ -22,11 +24,68 @@ void_func_t the_finalize    = NULL;
 int_func_t the_compute      = NULL;
 void_func_t the_refresh_img = NULL;
 void_func_t the_tile_check  = NULL;
+period_func_t the_period    = NULL;
 
 static tile_func_t the_tile_func = NULL;
 
+#ifdef ENABLE_PLUGINS
+
+#define DEFAULT_PLUGIN_DIR "lib"
+#define MAX_PLUGINS 16
+
+// Registry of the kernel plugins loaded so far
+static struct
+{
+  char *kernel;
+  void *handle;
+} plugins[MAX_PLUGINS];
+static int nb_plugins = 0;
+
+void hooks_load_kernel (char *kernel)
+{
+  char path[1024];
+  char *dir = getenv ("EASYPAP_PLUGIN_DIR");
+  void *handle;
+
+  for (int i = 0; i < nb_plugins; i++)
+    if (!strcmp (plugins[i].kernel, kernel))
+      return;
+
+  if (nb_plugins == MAX_PLUGINS)
+    exit_with_error ("Too many kernel plugins (%d)", MAX_PLUGINS);
+
+  sprintf (path, "%s/%s.so", dir != NULL ? dir : DEFAULT_PLUGIN_DIR, kernel);
+
+  // Symbols of a plugin remain private to it, so that kernels defining
+  // the same helper functions do not clash
+  handle = dlopen (path, RTLD_NOW | RTLD_LOCAL);
+  if (handle == NULL)
+    exit_with_error ("Cannot load kernel plugin [%s]: %s", path, dlerror ());
+
+  PRINT_DEBUG ('c', "Loaded kernel plugin [%s]\n", path);
+
+  plugins[nb_plugins].kernel   = strdup (kernel);
+  plugins[nb_plugins++].handle = handle;
+}
+
+#else
+
+void hooks_load_kernel (char *kernel)
+{
+}
+
+#endif
+
 void *hooks_find_symbol (char *symbol)
 {
+#ifdef ENABLE_PLUGINS
+  for (int i = 0; i < nb_plugins; i++) {
+    void *fun = dlsym (plugins[i].handle, symbol);
+    if (fun != NULL)
+      return fun;
+  }
+#endif
+
   return dlsym (DLSYM_FLAG, symbol);
 }
 
@@ -114,8 +173,47 @@ static void *bind_tile (char *kernel)
   return NULL;
 }
 
+void *hooks_find_specialized_tile (char *kernel, char *tile)
+{
+  char buffer[1024];
+  void *fun;
+
+  sprintf (buffer, "%s_do_tile_%s_d%d_%dx%d", kernel, tile, DIM, TILE_W,
+           TILE_H);
+  fun = hooks_find_symbol (buffer);
+  if (fun != NULL)
+    PRINT_DEBUG ('c', "Found specialized tiling func [%s]\n", buffer);
+
+  return fun;
+}
+
+// May be called again when the tile size changes (see --autotune)
+void hooks_specialize_tile (void)
+{
+  static void *generic = NULL;
+  void *fun;
+
+  if (the_tile_func == NULL)
+    return;
+
+  if (generic == NULL)
+    generic = the_tile_func;
+
+  fun           = hooks_find_specialized_tile (kernel_name, tile_name);
+  the_tile_func = (fun != NULL) ? fun : generic;
+}
+
 void hooks_establish_bindings (int silent)
 {
+  if (pipeline_establish_bindings ()) {
+    if (!silent)
+      PRINT_MASTER ("Using pipeline [%s], variant [%s], tiling [%s]\n",
+                    kernel_name, variant_name, tile_name);
+    return;
+  }
+
+  hooks_load_kernel (kernel_name);
+
   if (opencl_used) {
     the_compute = bind_it (kernel_name, "invoke", variant_name, 0);
     if (the_compute == NULL) {
@@ -132,6 +230,7 @@ void hooks_establish_bindings (int silent)
   the_draw        = bind_it (kernel_name, "draw", variant_name, 0);
   the_finalize    = bind_it (kernel_name, "finalize", variant_name, 0);
   the_refresh_img = bind_it (kernel_name, "refresh_img", variant_name, 0);
+  the_period      = bind_it (kernel_name, "period", variant_name, 0);
 
   if (!opencl_used) {
     the_first_touch = bind_it (kernel_name, "ft", variant_name, do_first_touch);
@@ -1,6 +1,8 @@
+#define _GNU_SOURCE
 #include <stdlib.h>
 #include <string.h>
 #include <sys/mman.h>
+#include <unistd.h>
 
 #include "debug.h"
 #include "error.h"
@@ -16,12 +18,79 @@ unsigned TILE_H     = 0;
 unsigned NB_TILES_X = 0;
 unsigned NB_TILES_Y = 0;
 
+// Ring buffer mode: the main image is backed by a memory file mapped twice,
+// back-to-back, so that image + k * DIM (0 <= k < DIM) always points to a
+// contiguous DIM x DIM image whose first row is row k of the ring.
+static int ring_mode        = 0;
+static int ring_fd          = -1;
+static uint32_t *ring_base  = NULL;
+static unsigned ring_offset = 0;
+
+void img_data_use_ring_buffer (void)
+{
+  if (image != NULL)
+    exit_with_error ("Ring buffer mode must be requested before images are "
+                     "allocated (e.g. in the init hook)");
+  ring_mode = 1;
+}
+
+static void ring_alloc (void)
+{
+#ifdef __linux__
+  size_t size = DIM * DIM * sizeof (uint32_t);
+
+  if (size % sysconf (_SC_PAGESIZE))
+    exit_with_error ("Ring buffer mode requires the image size (%zu bytes) to "
+                     "be a multiple of the page size",
+                     size);
+
+  ring_fd = memfd_create ("easypap-image", 0);
+  if (ring_fd == -1)
+    exit_with_error ("Cannot create ring buffer: memfd_create failed");
+
+  if (ftruncate (ring_fd, size) == -1)
+    exit_with_error ("Cannot create ring buffer: ftruncate failed");
+
+  // Reserve 2 x size of contiguous address space, then map the file twice
+  ring_base = mmap (NULL, 2 * size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1,
+                    0);
+  if (ring_base == MAP_FAILED)
+    exit_with_error ("Cannot reserve ring buffer: mmap failed");
+
+  for (int i = 0; i < 2; i++)
+    if (mmap ((char *)ring_base + i * size, size, PROT_READ | PROT_WRITE,
+              MAP_SHARED | MAP_FIXED, ring_fd, 0) == MAP_FAILED)
+      exit_with_error ("Cannot map ring buffer: mmap failed");
+
+  ring_offset = 0;
+  image       = ring_base;
+
+  PRINT_DEBUG ('i', "Main image uses a ring buffer\n");
+#else
+  exit_with_error ("Ring buffer mode is only available on Linux");
+#endif
+}
+
+void img_data_scroll (int rows)
+{
+  if (!ring_mode)
+    exit_with_error ("img_data_scroll requires ring buffer mode");
+
+  rows        = rows % (int)DIM;
+  ring_offset = (ring_offset + DIM + rows) % DIM;
+  image       = ring_base + ring_offset * DIM;
+}
+
 void img_data_alloc (void)
 {
-  image = mmap (NULL, DIM * DIM * sizeof (uint32_t), PROT_READ | PROT_WRITE,
-                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
-  if (image == NULL)
-    exit_with_error ("Cannot allocate main image: mmap failed");
+  if (ring_mode)
+    ring_alloc ();
+  else {
+    image = mmap (NULL, DIM * DIM * sizeof (uint32_t), PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (image == NULL)
+      exit_with_error ("Cannot allocate main image: mmap failed");
+  }
 
   alt_image = mmap (NULL, DIM * DIM * sizeof (uint32_t), PROT_READ | PROT_WRITE,
                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
@@ -33,7 +102,14 @@ void img_data_alloc (void)
 
 void img_data_free (void)
 {
-  if (image != NULL) {
+  if (ring_mode) {
+    if (ring_base != NULL) {
+      munmap (ring_base, 2 * DIM * DIM * sizeof (uint32_t));
+      close (ring_fd);
+      ring_base = NULL;
+      image     = NULL;
+    }
+  } else if (image != NULL) {
     munmap (image, DIM * DIM * sizeof (uint32_t));
     image = NULL;
   }
@@ -49,6 +125,56 @@ void img_data_replicate (void)
   memcpy (alt_image, image, DIM * DIM * sizeof (uint32_t));
 }
 
+// Copy of both images (and of where they were) taken by img_data_snapshot
+static struct
+{
+  uint32_t *image, *alt_image;
+  uint32_t *saved_image, *saved_alt_image;
+  unsigned ring_offset;
+} snapshot = {NULL, NULL, NULL, NULL, 0};
+
+void img_data_snapshot (void)
+{
+  const size_t size = DIM * DIM * sizeof (uint32_t);
+
+  if (snapshot.saved_image == NULL) {
+    snapshot.saved_image     = malloc (size);
+    snapshot.saved_alt_image = malloc (size);
+    if (snapshot.saved_image == NULL || snapshot.saved_alt_image == NULL)
+      exit_with_error ("Cannot allocate image snapshot");
+  }
+
+  snapshot.image       = image;
+  snapshot.alt_image   = alt_image;
+  snapshot.ring_offset = ring_offset;
+
+  memcpy (snapshot.saved_image, image, size);
+  memcpy (snapshot.saved_alt_image, alt_image, size);
+}
+
+void img_data_restore (void)
+{
+  const size_t size = DIM * DIM * sizeof (uint32_t);
+
+  if (snapshot.saved_image == NULL)
+    exit_with_error ("No image snapshot to restore");
+
+  // Undo swaps and scrolls
+  image       = snapshot.image;
+  alt_image   = snapshot.alt_image;
+  ring_offset = snapshot.ring_offset;
+
+  memcpy (image, snapshot.saved_image, size);
+  memcpy (alt_image, snapshot.saved_alt_image, size);
+}
+
+void img_data_free_snapshot (void)
+{
+  free (snapshot.saved_image);
+  free (snapshot.saved_alt_image);
+  snapshot.saved_image = snapshot.saved_alt_image = NULL;
+}
+
 unsigned heat_to_rgb (float h) // 0.0 = cold, 1.0 = hot
 {
   int i;
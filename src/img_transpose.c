@@ -0,0 +1,164 @@
+#include <stdint.h>
+
+#include "global.h"
+#include "img_transpose.h"
+
+#ifdef ENABLE_VECTO
+#if __AVX2__ == 1
+#define TRANSPOSE_AVX
+#include <immintrin.h>
+#endif
+#endif
+
+// Blocks whose both dimensions are below this threshold are not split
+// any more (32x32 pixels = 4KB per image)
+#define LEAF_SIZE 32
+
+static inline int dst_row (int i, int flags)
+{
+  return (flags & TRANSPOSE_FLIP_ROWS) ? DIM - 1 - i : i;
+}
+
+static void transpose_scalar (uint32_t *restrict dst, uint32_t *restrict src,
+                              int x, int y, int w, int h, int flags)
+{
+  for (int i = y; i < y + h; i++) {
+    uint32_t *d = dst + dst_row (i, flags) * DIM;
+
+    for (int j = x; j < x + w; j++)
+      d[j] = src[j * DIM + i];
+  }
+}
+
+#ifdef TRANSPOSE_AVX
+
+// Transposes the 8x8 block src (x..x+7, y..y+7) into rows y..y+7 of dst
+static inline void transpose_8x8 (uint32_t *restrict dst,
+                                  uint32_t *restrict src, int x, int y,
+                                  int flags)
+{
+  __m256i r0, r1, r2, r3, r4, r5, r6, r7;
+  __m256i t0, t1, t2, t3, t4, t5, t6, t7;
+
+  r0 = _mm256_loadu_si256 ((__m256i *)(src + (x + 0) * DIM + y));
+  r1 = _mm256_loadu_si256 ((__m256i *)(src + (x + 1) * DIM + y));
+  r2 = _mm256_loadu_si256 ((__m256i *)(src + (x + 2) * DIM + y));
+  r3 = _mm256_loadu_si256 ((__m256i *)(src + (x + 3) * DIM + y));
+  r4 = _mm256_loadu_si256 ((__m256i *)(src + (x + 4) * DIM + y));
+  r5 = _mm256_loadu_si256 ((__m256i *)(src + (x + 5) * DIM + y));
+  r6 = _mm256_loadu_si256 ((__m256i *)(src + (x + 6) * DIM + y));
+  r7 = _mm256_loadu_si256 ((__m256i *)(src + (x + 7) * DIM + y));
+
+  // Interleave 32-bit elements
+  t0 = _mm256_unpacklo_epi32 (r0, r1);
+  t1 = _mm256_unpackhi_epi32 (r0, r1);
+  t2 = _mm256_unpacklo_epi32 (r2, r3);
+  t3 = _mm256_unpackhi_epi32 (r2, r3);
+  t4 = _mm256_unpacklo_epi32 (r4, r5);
+  t5 = _mm256_unpackhi_epi32 (r4, r5);
+  t6 = _mm256_unpacklo_epi32 (r6, r7);
+  t7 = _mm256_unpackhi_epi32 (r6, r7);
+
+  // Interleave 64-bit elements
+  r0 = _mm256_unpacklo_epi64 (t0, t2);
+  r1 = _mm256_unpackhi_epi64 (t0, t2);
+  r2 = _mm256_unpacklo_epi64 (t1, t3);
+  r3 = _mm256_unpackhi_epi64 (t1, t3);
+  r4 = _mm256_unpacklo_epi64 (t4, t6);
+  r5 = _mm256_unpackhi_epi64 (t4, t6);
+  r6 = _mm256_unpacklo_epi64 (t5, t7);
+  r7 = _mm256_unpackhi_epi64 (t5, t7);
+
+  // Exchange 128-bit lanes
+  t0 = _mm256_permute2x128_si256 (r0, r4, 0x20);
+  t1 = _mm256_permute2x128_si256 (r1, r5, 0x20);
+  t2 = _mm256_permute2x128_si256 (r2, r6, 0x20);
+  t3 = _mm256_permute2x128_si256 (r3, r7, 0x20);
+  t4 = _mm256_permute2x128_si256 (r0, r4, 0x31);
+  t5 = _mm256_permute2x128_si256 (r1, r5, 0x31);
+  t6 = _mm256_permute2x128_si256 (r2, r6, 0x31);
+  t7 = _mm256_permute2x128_si256 (r3, r7, 0x31);
+
+  __m256i *d[8];
+  for (int k = 0; k < 8; k++)
+    d[k] = (__m256i *)(dst + dst_row (y + k, flags) * DIM + x);
+
+  if (flags & TRANSPOSE_STREAM) {
+    _mm256_stream_si256 (d[0], t0);
+    _mm256_stream_si256 (d[1], t1);
+    _mm256_stream_si256 (d[2], t2);
+    _mm256_stream_si256 (d[3], t3);
+    _mm256_stream_si256 (d[4], t4);
+    _mm256_stream_si256 (d[5], t5);
+    _mm256_stream_si256 (d[6], t6);
+    _mm256_stream_si256 (d[7], t7);
+  } else {
+    _mm256_storeu_si256 (d[0], t0);
+    _mm256_storeu_si256 (d[1], t1);
+    _mm256_storeu_si256 (d[2], t2);
+    _mm256_storeu_si256 (d[3], t3);
+    _mm256_storeu_si256 (d[4], t4);
+    _mm256_storeu_si256 (d[5], t5);
+    _mm256_storeu_si256 (d[6], t6);
+    _mm256_storeu_si256 (d[7], t7);
+  }
+}
+
+#endif
+
+static void transpose_leaf (uint32_t *restrict dst, uint32_t *restrict src,
+                            int x, int y, int w, int h, int flags)
+{
+#ifdef TRANSPOSE_AVX
+  int w8 = w & ~7, h8 = h & ~7;
+
+  for (int i = y; i < y + h8; i += 8)
+    for (int j = x; j < x + w8; j += 8)
+      transpose_8x8 (dst, src, j, i, flags);
+
+  // Remainders
+  if (w8 < w)
+    transpose_scalar (dst, src, x + w8, y, w - w8, h, flags);
+  if (h8 < h)
+    transpose_scalar (dst, src, x, y + h8, w8, h - h8, flags);
+#else
+  transpose_scalar (dst, src, x, y, w, h, flags);
+#endif
+}
+
+static void transpose_rec (uint32_t *restrict dst, uint32_t *restrict src,
+                           int x, int y, int w, int h, int flags)
+{
+  if (w <= LEAF_SIZE && h <= LEAF_SIZE)
+    transpose_leaf (dst, src, x, y, w, h, flags);
+  else if (w >= h) {
+    // Split along columns, on a multiple of 8
+    int half = ((w / 2) + 7) & ~7;
+
+    transpose_rec (dst, src, x, y, half, h, flags);
+    transpose_rec (dst, src, x + half, y, w - half, h, flags);
+  } else {
+    int half = ((h / 2) + 7) & ~7;
+
+    transpose_rec (dst, src, x, y, w, half, flags);
+    transpose_rec (dst, src, x, y + half, w, h - half, flags);
+  }
+}
+
+void img_transpose_block (uint32_t *restrict dst, uint32_t *restrict src,
+                          int x, int y, int w, int h, int flags)
+{
+#ifdef TRANSPOSE_AVX
+  // Non-temporal stores require 32-byte aligned destinations
+  if ((flags & TRANSPOSE_STREAM) &&
+      ((DIM % 8) || (x % 8) || ((uintptr_t)dst % 32)))
+    flags &= ~TRANSPOSE_STREAM;
+#endif
+
+  transpose_rec (dst, src, x, y, w, h, flags);
+
+#ifdef TRANSPOSE_AVX
+  if (flags & TRANSPOSE_STREAM)
+    _mm_sfence ();
+#endif
+}
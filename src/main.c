@@ -1,9 +1,12 @@
 #include <fcntl.h>
 #include <hwloc.h>
+#include <inttypes.h>
 #include <stdio.h>
 #include <string.h>
 #include <sys/time.h>
 #include <sys/utsname.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 #ifdef ENABLE_SDL
 #include <SDL.h>
@@ -13,12 +16,15 @@
 #include <mpi.h>
 #endif
 
+#include "autotune.h"
+#include "bench.h"
 #include "constants.h"
 #include "cpustat.h"
 #include "easypap.h"
 #include "graphics.h"
 #include "hooks.h"
 #include "ocl.h"
+#include "perfcounter.h"
 #include "trace_record.h"
 
 int max_iter            = 0;
@@ -34,7 +40,8 @@ char *tile_name          = NULL;
 char *draw_param         = NULL;
 char *easypap_image_file = NULL;
 
-static char *output_file = "./plots/data/perf_data.csv";
+static char *output_file   = "./plots/data/perf_data.csv";
+static char *autotune_file = "./plots/data/autotune.csv";
 #define MAX_LABEL 64
 static char trace_label[MAX_LABEL] = {0};
 
@@ -52,6 +59,18 @@ static unsigned do_thumbs __attribute__ ((unused))         = 0;
 static unsigned show_ocl_config                            = 0;
 static unsigned list_ocl_variants                          = 0;
 static unsigned trace_starting_iteration                   = 1;
+static unsigned trace_fxt __attribute__ ((unused))         = 0;
+static unsigned trace_live __attribute__ ((unused))        = 0;
+static unsigned trace_every __attribute__ ((unused))       = 1;
+static double trace_tiles __attribute__ ((unused))         = 1.0;
+static long trace_budget __attribute__ ((unused))          = 0;
+static unsigned fold_iterations                            = 0;
+static unsigned bench_runs                                 = 0;
+static unsigned bench_warmup                               = 0;
+static unsigned do_autotune                                = 0;
+
+// Hardware counters of the last timed run (see --perf-counters)
+static perfcounter_values_t run_counters;
 
 static hwloc_topology_t topology;
 
@@ -133,6 +152,24 @@ void easypap_vec_check (unsigned vec_width_in_bytes, direction_t dir)
 #endif
 }
 
+// Kernels may declare a period p (e.g. rotation90 is the identity after 4
+// iterations) through a <kernel>_period[_<variant>] hook. When folding is
+// enabled, nb_iter iterations are then replaced by nb_iter % p iterations.
+// Refresh points are untouched since folding happens between them.
+static int compute_iterations (unsigned nb_iter)
+{
+  if (fold_iterations && the_period != NULL) {
+    unsigned p = the_period ();
+
+    if (p > 0) {
+      nb_iter %= p;
+      return nb_iter ? the_compute (nb_iter) : 0;
+    }
+  }
+
+  return the_compute (nb_iter);
+}
+
 static void update_refresh_rate (int p)
 {
   static int tab_refresh_rate[] = {1, 2, 5, 10, 100, 1000};
@@ -147,30 +184,96 @@ static void update_refresh_rate (int p)
   printf ("< Refresh rate set to: %d >\n", refresh_rate);
 }
 
-static void output_perf_numbers (long time_in_us, unsigned nb_iter)
+// Returns -1 if the performance file does not exist yet, 1 if its header
+// contains ";column", 0 otherwise
+static int perf_file_has_column (char *column)
 {
-  FILE *f = fopen (output_file, "a");
+  FILE *f = fopen (output_file, "r");
+  char header[1024];
+  int r = -1;
+
+  if (f == NULL)
+    return -1;
+
+  if (fgets (header, sizeof (header), f) != NULL)
+    r = (strstr (header, column) != NULL);
+
+  fclose (f);
+  return r;
+}
+
+// Benchmark statistics columns (see --bench)
+static int perf_file_has_stats (void)
+{
+  return perf_file_has_column (";runs;");
+}
+
+// Hardware counters columns (see --perf-counters)
+static int perf_file_has_counters (void)
+{
+  return perf_file_has_column (";cycles;");
+}
+
+// stats may be NULL if time_in_us is the time of a single run
+static void output_perf_numbers (long time_in_us, unsigned nb_iter,
+                                 bench_stats_t *stats)
+{
+  int has_stats    = perf_file_has_stats ();
+  int has_counters = perf_file_has_counters ();
+  FILE *f;
   struct utsname s;
 
+  f = fopen (output_file, "a");
   if (f == NULL)
     exit_with_error ("Cannot open \"%s\" file (%s)", output_file,
                      strerror (errno));
 
+  if (has_stats == -1)
+    has_stats = (stats != NULL);
+  if (has_counters == -1)
+    has_counters = do_perfcounters;
+
   if (ftell (f) == 0) {
-    fprintf (f, "%s;%s;%s;%s;%s;%s;%s;%s;%s;%s;%s;%s;%s;%s\n", "machine", "size",
+    fprintf (f, "%s;%s;%s;%s;%s;%s;%s;%s;%s;%s;%s;%s;%s;%s", "machine", "size",
              "tilew", "tileh", "threads", "kernel", "variant", "tiling", "iterations",
              "schedule", "places", "label", "arg", "time");
+    if (has_stats)
+      fprintf (f, ";%s;%s;%s;%s;%s;%s", "runs", "min", "median", "mean",
+               "stddev", "ci95");
+    if (has_counters)
+      for (int c = 0; c < NB_COUNTERS; c++)
+        fprintf (f, ";%s", counter_names[c]);
+    fprintf (f, "\n");
   }
 
   if (uname (&s) < 0)
     exit_with_error ("uname failed (%s)", strerror (errno));
 
-  fprintf (f, "%s;%u;%u;%u;%u;%s;%s;%s;%u;%s;%s;%s;%s;%ld\n", s.nodename, DIM,
+  fprintf (f, "%s;%u;%u;%u;%u;%s;%s;%s;%u;%s;%s;%s;%s;%ld", s.nodename, DIM,
            TILE_W, TILE_H, easypap_requested_number_of_threads (), kernel_name,
            variant_name, tile_name, nb_iter, easypap_omp_schedule (),
            easypap_omp_places (), trace_label, (draw_param ?: "none"),
            time_in_us);
 
+  if (has_stats) {
+    if (stats != NULL)
+      fprintf (f, ";%u;%ld;%ld;%.1f;%.1f;%.1f", stats->runs, stats->min,
+               stats->median, stats->mean, stats->stddev, stats->ci95);
+    else
+      fprintf (f, ";1;%ld;%ld;%ld.0;0.0;0.0", time_in_us, time_in_us,
+               time_in_us);
+  }
+
+  // Unavailable counters are left empty
+  if (has_counters)
+    for (int c = 0; c < NB_COUNTERS; c++) {
+      if (do_perfcounters && (perfcounter_available () & (1U << c)))
+        fprintf (f, ";%" PRIu64, run_counters.value[c]);
+      else
+        fprintf (f, ";");
+    }
+  fprintf (f, "\n");
+
   fclose (f);
 }
 
@@ -297,8 +400,34 @@ static void init_phases (void)
 #endif
 
   // At this point, we know the value of DIM
+  if (!opencl_used && !do_autotune && !TILE_W && !TILE_H && !NB_TILES_X &&
+      !NB_TILES_Y) {
+    autotune_config_t cfg;
+
+    if (autotune_cache_lookup (autotune_file, &cfg)) {
+      TILE_W = cfg.tile_w;
+      TILE_H = cfg.tile_h;
+      // An explicit OMP_SCHEDULE takes precedence
+      if (getenv ("OMP_SCHEDULE") == NULL)
+        autotune_apply_schedule (cfg.schedule);
+      PRINT_MASTER ("Using autotuned configuration: %dx%d tiles, schedule "
+                    "%s\n",
+                    TILE_W, TILE_H, easypap_omp_schedule ());
+    }
+  }
+
+  // Initial tiles only need to fit DIM when they are autotuned afterwards
+  if (do_autotune && !TILE_W && !TILE_H && !NB_TILES_X && !NB_TILES_Y &&
+      DIM % DEFAULT_CPU_TILE_SIZE)
+    TILE_W = DIM;
+
   check_tile_size ();
 
+  hooks_specialize_tile ();
+
+  if (do_perfcounters)
+    perfcounter_init ();
+
 #ifdef ENABLE_MONITORING
 #ifdef ENABLE_TRACE
   if (trace_may_be_used) {
@@ -307,15 +436,25 @@ static void init_phases (void)
     if (easypap_mpirun)
       sprintf (filename, "%s/%s.%d%s", DEFAULT_EZV_TRACE_DIR,
                DEFAULT_EZV_TRACE_BASE, easypap_mpi_rank (),
-               DEFAULT_EZV_TRACE_EXT);
+               trace_live  ? DEFAULT_EZV_LIVE_EXT
+               : trace_fxt ? DEFAULT_EZV_FXT_EXT
+                           : DEFAULT_EZV_TRACE_EXT);
     else
-      strcpy (filename, DEFAULT_EASYVIEW_FILE);
+      sprintf (filename, "%s/%s", DEFAULT_EZV_TRACE_DIR,
+               trace_live  ? DEFAULT_EZV_LIVE_FILE
+               : trace_fxt ? DEFAULT_EZV_FXT_FILE
+                           : DEFAULT_EZV_TRACE_FILE);
 
     set_default_trace_label ();
 
     trace_record_init (filename, easypap_requested_number_of_threads (),
                        easypap_number_of_gpus (), DIM, trace_label,
                        trace_starting_iteration);
+
+    trace_record_set_sampling (trace_every, trace_tiles, trace_budget);
+
+    if (do_perfcounters)
+      trace_record_declare_counters (perfcounter_available ());
   }
 #endif
 #endif
@@ -389,11 +528,229 @@ static void init_phases (void)
     PRINT_DEBUG ('i', "Init phase 7: [no OpenCL data transfer involved]\n");
 }
 
+// Runs iterations without display, and returns the elapsed time (µs)
+static long run_no_display (int *iterations, unsigned *iter_no)
+{
+  struct timeval t1, t2;
+  int stable = 0;
+  int n;
+
+  if (do_perfcounters)
+    perfcounter_reset ();
+
+  gettimeofday (&t1, NULL);
+
+  while (!stable) {
+    if (max_iter && *iterations >= max_iter) {
+      *iterations = max_iter;
+      stable      = 1;
+    } else {
+
+      if (max_iter && *iterations + refresh_rate > max_iter)
+        refresh_rate = max_iter - *iterations;
+
+#ifdef ENABLE_TRACE
+      if (trace_may_be_used && (*iterations + 1 == trace_starting_iteration))
+        do_trace = 1;
+#endif
+
+      monitoring_start_iteration ();
+
+      n = compute_iterations (refresh_rate);
+
+      monitoring_end_iteration ();
+
+      if (n > 0) {
+        *iterations += n;
+        stable = 1;
+      } else
+        *iterations += refresh_rate;
+
+#ifdef ENABLE_SDL
+      if (do_thumbs && *iterations >= trace_starting_iteration) {
+        if (the_refresh_img)
+          the_refresh_img ();
+        else if (opencl_used)
+          ocl_retrieve_data ();
+
+        if (easypap_proc_is_master ())
+          graphics_save_thumbnail ((*iter_no)++);
+      }
+#endif
+    }
+  }
+
+  gettimeofday (&t2, NULL);
+
+  if (do_perfcounters)
+    perfcounter_read_total (&run_counters);
+
+  return TIME_DIFF (t1, t2);
+}
+
+// Benchmark mode: warmup runs followed by bench_runs timed runs, each
+// starting from the initial images and calling the draw hook again (so
+// that kernels can reset their own data). Returns the median time (µs).
+// Hardware counters are averaged over timed runs.
+static long run_bench (int *iterations, bench_stats_t *stats)
+{
+  const unsigned rate           = refresh_rate;
+  long *samples                 = malloc (bench_runs * sizeof (long));
+  perfcounter_values_t counters = {{0}};
+
+  if (samples == NULL)
+    exit_with_error ("Cannot allocate benchmark samples");
+
+  img_data_snapshot ();
+
+  for (unsigned r = 0; r < bench_warmup + bench_runs; r++) {
+    unsigned iter_no = 1;
+    long t;
+
+    if (r > 0) {
+      img_data_restore ();
+      if (the_draw != NULL)
+        the_draw (draw_param);
+      if (opencl_used)
+        ocl_send_data ();
+    }
+
+    refresh_rate = rate;
+    *iterations  = 0;
+
+#ifdef ENABLE_MPI
+    if (easypap_mpirun)
+      MPI_Barrier (MPI_COMM_WORLD);
+#endif
+
+    t = run_no_display (iterations, &iter_no);
+
+    PRINT_DEBUG ('u', "%s run %u: %ld.%03ld ms\n",
+                 r < bench_warmup ? "Warmup" : "Bench", r, t / 1000, t % 1000);
+
+    if (r >= bench_warmup) {
+      samples[r - bench_warmup] = t;
+      for (int c = 0; c < NB_COUNTERS; c++)
+        counters.value[c] += run_counters.value[c];
+    }
+  }
+
+  for (int c = 0; c < NB_COUNTERS; c++)
+    run_counters.value[c] = counters.value[c] / bench_runs;
+
+  bench_compute_stats (samples, bench_runs, stats);
+
+  free (samples);
+  img_data_free_snapshot ();
+
+  return stats->median;
+}
+
+static void set_tiling (autotune_config_t *cfg)
+{
+  TILE_W     = cfg->tile_w;
+  TILE_H     = cfg->tile_h;
+  NB_TILES_X = DIM / TILE_W;
+  NB_TILES_Y = DIM / TILE_H;
+
+  autotune_apply_schedule (cfg->schedule);
+  hooks_specialize_tile ();
+
+  if (the_tile_check != NULL)
+    the_tile_check ();
+}
+
+// Tile check hooks exit on error, so they are tried in a child process
+static int autotune_valid (autotune_config_t *cfg)
+{
+  pid_t pid;
+  int status;
+
+  if (the_tile_check == NULL)
+    return 1;
+
+  fflush (NULL);
+
+  pid = fork ();
+  if (pid < 0)
+    exit_with_error ("fork failed (%s)", strerror (errno));
+
+  if (pid == 0) {
+    int fd = open ("/dev/null", O_WRONLY);
+
+    dup2 (fd, STDOUT_FILENO);
+    dup2 (fd, STDERR_FILENO);
+
+    TILE_W     = cfg->tile_w;
+    TILE_H     = cfg->tile_h;
+    NB_TILES_X = DIM / TILE_W;
+    NB_TILES_Y = DIM / TILE_H;
+    the_tile_check ();
+
+    _exit (EXIT_SUCCESS);
+  }
+
+  if (waitpid (pid, &status, 0) < 0)
+    exit_with_error ("waitpid failed (%s)", strerror (errno));
+
+  return WIFEXITED (status) && WEXITSTATUS (status) == EXIT_SUCCESS;
+}
+
+static double autotune_measure (autotune_config_t *cfg, unsigned nb_iter)
+{
+  const int saved_max_iter = max_iter;
+  int iterations           = 0;
+  unsigned iter_no         = 1;
+  long t;
+
+  set_tiling (cfg);
+
+  img_data_restore ();
+  if (the_draw != NULL)
+    the_draw (draw_param);
+
+  max_iter     = nb_iter;
+  refresh_rate = nb_iter;
+
+  t = run_no_display (&iterations, &iter_no);
+
+  max_iter = saved_max_iter;
+
+  return (double)t / (iterations ?: 1);
+}
+
+// Autotuning mode: short runs (starting from the initial images) select
+// the best tile size and schedule, which is then used for the real run and
+// saved into autotune_file
+static void run_autotune (void)
+{
+  const unsigned rate = refresh_rate;
+  autotune_config_t best;
+
+  img_data_snapshot ();
+
+  autotune_search (&best, max_iter ? (max_iter + 7) / 8 : 1, autotune_valid,
+                   autotune_measure);
+  set_tiling (&best);
+
+  img_data_restore ();
+  if (the_draw != NULL)
+    the_draw (draw_param);
+  img_data_free_snapshot ();
+
+  refresh_rate = rate;
+
+  PRINT_MASTER ("Autotuned configuration: %dx%d tiles, schedule %s\n",
+                TILE_W, TILE_H, best.schedule);
+
+  autotune_cache_store (autotune_file, &best);
+}
+
 int main (int argc, char **argv)
 {
-  int stable       = 0;
-  int iterations   = 0;
-  unsigned iter_no = 1;
+  int stable __attribute__ ((unused)) = 0;
+  int iterations                      = 0;
+  unsigned iter_no                    = 1;
 
   filter_args (&argc, argv);
 
@@ -520,7 +877,7 @@ int main (int argc, char **argv)
 
             monitoring_start_iteration ();
 
-            n = the_compute (refresh_rate);
+            n = compute_iterations (refresh_rate);
 
             monitoring_end_iteration ();
 
@@ -560,8 +917,6 @@ int main (int argc, char **argv)
   {
     // Version non graphique
     long temps;
-    struct timeval t1, t2;
-    int n;
 
     if (trace_may_be_used | do_thumbs)
       refresh_rate = 1;
@@ -573,57 +928,44 @@ int main (int argc, char **argv)
         refresh_rate = 1;
     }
 
-    gettimeofday (&t1, NULL);
+    if (do_perfcounters && easypap_proc_is_master () &&
+        perf_file_has_counters () == 0)
+      exit_with_error ("\"%s\" has no hardware counters columns: please use "
+                       "another file for --perf-counters runs (see "
+                       "--output-file)",
+                       output_file);
 
-    while (!stable) {
-      if (max_iter && iterations >= max_iter) {
-        iterations = max_iter;
-        stable     = 1;
-      } else {
+    if (do_autotune)
+      run_autotune ();
 
-        if (max_iter && iterations + refresh_rate > max_iter)
-          refresh_rate = max_iter - iterations;
+    if (bench_runs) {
+      bench_stats_t stats;
 
-#ifdef ENABLE_TRACE
-        if (trace_may_be_used && (iterations + 1 == trace_starting_iteration))
-          do_trace = 1;
-#endif
+      if (easypap_proc_is_master () && perf_file_has_stats () == 0)
+        exit_with_error ("\"%s\" has no statistics columns: please use "
+                         "another file for --bench runs (see --output-file)",
+                         output_file);
 
-        monitoring_start_iteration ();
+      temps = run_bench (&iterations, &stats);
 
-        n = the_compute (refresh_rate);
+      PRINT_MASTER ("Computation completed after %d iterations\n", iterations);
+      PRINT_MASTER ("%u runs (+%u warmup): min %ld.%03ld, median %ld.%03ld, "
+                    "mean %.3f, stddev %.3f, ci95 +/- %.3f\n",
+                    stats.runs, bench_warmup, stats.min / 1000,
+                    stats.min % 1000, stats.median / 1000, stats.median % 1000,
+                    stats.mean / 1000, stats.stddev / 1000, stats.ci95 / 1000);
 
-        monitoring_end_iteration ();
+      if (easypap_proc_is_master ())
+        output_perf_numbers (temps, iterations, &stats);
+    } else {
+      temps = run_no_display (&iterations, &iter_no);
 
-        if (n > 0) {
-          iterations += n;
-          stable = 1;
-        } else
-          iterations += refresh_rate;
+      PRINT_MASTER ("Computation completed after %d iterations\n", iterations);
 
-#ifdef ENABLE_SDL
-        if (do_thumbs && iterations >= trace_starting_iteration) {
-          if (the_refresh_img)
-            the_refresh_img ();
-          else if (opencl_used)
-            ocl_retrieve_data ();
-
-          if (easypap_proc_is_master ())
-            graphics_save_thumbnail (iter_no++);
-        }
-#endif
-      }
+      if (easypap_proc_is_master ())
+        output_perf_numbers (temps, iterations, NULL);
     }
 
-    gettimeofday (&t2, NULL);
-
-    PRINT_MASTER ("Computation completed after %d iterations\n", iterations);
-
-    temps = TIME_DIFF (t1, t2);
-
-    if (easypap_proc_is_master ())
-      output_perf_numbers (temps, iterations);
-
     PRINT_MASTER ("%ld.%03ld \n", temps / 1000, temps % 1000);
   }
 
@@ -657,6 +999,9 @@ int main (int argc, char **argv)
   if (the_finalize != NULL)
     the_finalize ();
 
+  if (do_perfcounters)
+    perfcounter_finalize ();
+
 #ifdef ENABLE_SDL
   graphics_clean ();
 #endif
@@ -678,9 +1023,15 @@ static void usage (int val)
   fprintf (
       stderr,
       "\t-a\t| --arg <string>\t: pass argument <string> to draw function\n");
+  fprintf (stderr, "\t-at\t| --autotune\t\t: select the best tile size and "
+                   "schedule first\n");
+  fprintf (stderr, "\t-bn\t| --bench <N>\t\t: time N runs in a row and "
+                   "report statistics\n");
   fprintf (stderr, "\t-d\t| --debug-flags <flags>\t: enable debug messages "
                    "(see debug.h)\n");
   fprintf (stderr, "\t-du\t| --dump\t\t: dump final image to disk\n");
+  fprintf (stderr, "\t-fi\t| --fold-iterations\t: skip iterations of "
+                   "periodic kernels\n");
   fprintf (stderr,
            "\t-ft\t| --first-touch\t\t: touch memory on different cores\n");
   fprintf (stderr, "\t-h\t| --help\t\t: display help\n");
@@ -702,6 +1053,8 @@ static void usage (int val)
   fprintf (stderr, "\t-o\t| --ocl\t\t\t: use OpenCL version\n");
   fprintf (stderr, "\t-of\t| --output-file <file>\t: output performance "
                    "numbers in <file>\n");
+  fprintf (stderr, "\t-pc\t| --perf-counters\t: record hardware counters "
+                   "(performance file, traces)\n");
   fprintf (stderr, "\t-p\t| --pause\t\t: pause between iterations (press space "
                    "to continue)\n");
   fprintf (stderr, "\t-q\t| --quit\t\t: exit once iterations are done\n");
@@ -725,9 +1078,21 @@ static void usage (int val)
   fprintf (
       stderr,
       "\t-ti\t| --trace-iter <n>\t: enable trace starting from iteration n\n");
+  fprintf (stderr,
+           "\t-tf\t| --trace-fxt\t\t: record trace using the FxT format\n");
+  fprintf (stderr,
+           "\t-tl\t| --trace-live\t\t: stream trace to easyview --live\n");
+  fprintf (stderr,
+           "\t-te\t| --trace-every <k>\t: trace one iteration out of k\n");
+  fprintf (stderr, "\t-tt\t| --trace-tiles <r>\t: trace a random fraction r "
+                   "of tiles\n");
+  fprintf (stderr, "\t-tb\t| --trace-budget <us>\t: trace tiles starting "
+                   "during the first us µs of iterations\n");
   fprintf (stderr,
            "\t-v\t| --variant <name>\t: select variant <name> of kernel\n");
   fprintf (stderr, "\t-wt\t| --with-tile <name>\t\t: select do_tile_<name>\n");
+  fprintf (stderr, "\t-wu\t| --warmup <W>\t\t: perform W untimed runs before "
+                   "benchmarking\n");
 
   exit (val);
 }
@@ -770,6 +1135,8 @@ static void filter_args (int *argc, char *argv[])
       do_display        = 0;
     } else if (!strcmp (*argv, "--first-touch") || !strcmp (*argv, "-ft")) {
       do_first_touch = 1;
+    } else if (!strcmp (*argv, "--fold-iterations") || !strcmp (*argv, "-fi")) {
+      fold_iterations = 1;
     } else if (!strcmp (*argv, "--monitoring") || !strcmp (*argv, "-m")) {
 #ifndef ENABLE_SDL
       fprintf (stderr, "Warning: cannot monitor execution when ENABLE_SDL is "
@@ -799,6 +1166,82 @@ static void filter_args (int *argc, char *argv[])
 #else
       trace_starting_iteration = atoi (*argv);
       trace_may_be_used        = 1;
+#endif
+    } else if (!strcmp (*argv, "--trace-fxt") || !strcmp (*argv, "-tf")) {
+#ifndef ENABLE_TRACE
+      fprintf (
+          stderr,
+          "Warning: cannot generate trace if ENABLE_TRACE is not defined\n");
+#else
+      trace_fxt         = 1;
+      trace_may_be_used = 1;
+#endif
+    } else if (!strcmp (*argv, "--trace-live") || !strcmp (*argv, "-tl")) {
+#ifndef ENABLE_TRACE
+      fprintf (
+          stderr,
+          "Warning: cannot generate trace if ENABLE_TRACE is not defined\n");
+#else
+      trace_live        = 1;
+      trace_may_be_used = 1;
+#endif
+    } else if (!strcmp (*argv, "--trace-every") || !strcmp (*argv, "-te")) {
+      if (*argc == 1) {
+        fprintf (stderr, "Error: sampling period is missing\n");
+        usage (1);
+      }
+      (*argc)--;
+      argv++;
+#ifndef ENABLE_TRACE
+      fprintf (
+          stderr,
+          "Warning: cannot generate trace if ENABLE_TRACE is not defined\n");
+#else
+      int every = atoi (*argv);
+      if (every < 1) {
+        fprintf (stderr, "Error: sampling period must be positive\n");
+        usage (1);
+      }
+      trace_every       = every;
+      trace_may_be_used = 1;
+#endif
+    } else if (!strcmp (*argv, "--trace-tiles") || !strcmp (*argv, "-tt")) {
+      if (*argc == 1) {
+        fprintf (stderr, "Error: tile ratio is missing\n");
+        usage (1);
+      }
+      (*argc)--;
+      argv++;
+#ifndef ENABLE_TRACE
+      fprintf (
+          stderr,
+          "Warning: cannot generate trace if ENABLE_TRACE is not defined\n");
+#else
+      trace_tiles = atof (*argv);
+      if (!(trace_tiles > 0.0 && trace_tiles <= 1.0)) {
+        fprintf (stderr, "Error: tile ratio must be in (0, 1]\n");
+        usage (1);
+      }
+      trace_may_be_used = 1;
+#endif
+    } else if (!strcmp (*argv, "--trace-budget") || !strcmp (*argv, "-tb")) {
+      if (*argc == 1) {
+        fprintf (stderr, "Error: time budget is missing\n");
+        usage (1);
+      }
+      (*argc)--;
+      argv++;
+#ifndef ENABLE_TRACE
+      fprintf (
+          stderr,
+          "Warning: cannot generate trace if ENABLE_TRACE is not defined\n");
+#else
+      trace_budget = atol (*argv);
+      if (trace_budget < 1) {
+        fprintf (stderr, "Error: time budget must be positive\n");
+        usage (1);
+      }
+      trace_may_be_used = 1;
 #endif
     } else if (!strcmp (*argv, "--thumbnails") || !strcmp (*argv, "-tn")) {
 #ifndef ENABLE_SDL
@@ -976,6 +1419,40 @@ static void filter_args (int *argc, char *argv[])
       argv++;
 
       debug_init (*argv);
+    } else if (!strcmp (*argv, "--bench") || !strcmp (*argv, "-bn")) {
+      if (*argc == 1) {
+        fprintf (stderr, "Error: number of runs is missing\n");
+        usage (1);
+      }
+      (*argc)--;
+      argv++;
+      int runs = atoi (*argv);
+      if (runs < 1) {
+        fprintf (stderr, "Error: number of runs must be positive\n");
+        usage (1);
+      }
+      bench_runs = runs;
+      // Benchmarks are always run without display
+      do_display = 0;
+    } else if (!strcmp (*argv, "--perf-counters") || !strcmp (*argv, "-pc")) {
+      do_perfcounters = 1;
+    } else if (!strcmp (*argv, "--autotune") || !strcmp (*argv, "-at")) {
+      do_autotune = 1;
+      // Autotuning is always done without display
+      do_display = 0;
+    } else if (!strcmp (*argv, "--warmup") || !strcmp (*argv, "-wu")) {
+      if (*argc == 1) {
+        fprintf (stderr, "Error: number of warmup runs is missing\n");
+        usage (1);
+      }
+      (*argc)--;
+      argv++;
+      int runs = atoi (*argv);
+      if (runs < 0) {
+        fprintf (stderr, "Error: number of warmup runs must not be negative\n");
+        usage (1);
+      }
+      bench_warmup = runs;
     } else if (!strcmp (*argv, "--output-file") || !strcmp (*argv, "-of")) {
       if (*argc == 1) {
         fprintf (stderr, "Error: filename is missing\n");
@@ -1000,4 +1477,17 @@ static void filter_args (int *argc, char *argv[])
     do_display = 0;
   }
 #endif
+
+  if (bench_runs && (trace_may_be_used || do_thumbs)) {
+    fprintf (stderr, "Error: --bench cannot be used along with traces or "
+                     "thumbnails\n");
+    usage (1);
+  }
+
+  if (do_autotune && (trace_may_be_used || do_thumbs || opencl_used ||
+                      easypap_mpirun)) {
+    fprintf (stderr, "Error: --autotune cannot be used along with traces, "
+                     "thumbnails, OpenCL or MPI\n");
+    usage (1);
+  }
 }
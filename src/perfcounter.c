@@ -0,0 +1,233 @@
+#include <errno.h>
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+#include "debug.h"
+#include "error.h"
+#include "perfcounter.h"
+
+unsigned do_perfcounters = 0;
+
+#ifdef __linux__
+
+static const uint64_t configs[NB_COUNTERS] = {
+    PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+
+// One group of counters per thread, read at once through its leader. Each
+// thread uses its own cache line to store start values.
+typedef struct
+{
+  int leader;
+  int fd[NB_COUNTERS];
+  perfcounter_values_t tile_start;
+} __attribute__ ((aligned (64))) thread_counters_t;
+
+static thread_counters_t *threads = NULL;
+static unsigned nb_threads        = 0;
+static unsigned available         = 0;
+static perfcounter_values_t iteration_start;
+
+static int open_counter (uint64_t config, int group)
+{
+  struct perf_event_attr attr;
+
+  memset (&attr, 0, sizeof (attr));
+  attr.size           = sizeof (attr);
+  attr.type           = PERF_TYPE_HARDWARE;
+  attr.config         = config;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv     = 1;
+  attr.read_format    = PERF_FORMAT_GROUP;
+
+  // pid = 0, cpu = -1: calling thread, on any CPU
+  return syscall (SYS_perf_event_open, &attr, 0, -1, group, 0);
+}
+
+static void open_thread_counters (thread_counters_t *tc)
+{
+  tc->leader = -1;
+
+  for (int c = 0; c < NB_COUNTERS; c++) {
+    tc->fd[c] = open_counter (configs[c], tc->leader);
+
+    if (tc->fd[c] >= 0) {
+      if (tc->leader == -1)
+        tc->leader = tc->fd[c];
+    } else
+      PRINT_DEBUG ('m', "Counter %s unavailable for thread %d (%s)\n",
+                   counter_names[c], omp_get_thread_num (), strerror (errno));
+  }
+}
+
+void perfcounter_init (void)
+{
+  unsigned mask = (1U << NB_COUNTERS) - 1;
+
+  nb_threads = omp_get_max_threads ();
+  threads    = aligned_alloc (64, nb_threads * sizeof (thread_counters_t));
+  if (threads == NULL)
+    exit_with_error ("Cannot allocate hardware counters");
+
+  // Counters measure the thread which opens them
+#pragma omp parallel num_threads(nb_threads)
+  open_thread_counters (threads + omp_get_thread_num ());
+
+  // Only keep counters available to all threads
+  for (int t = 0; t < nb_threads; t++)
+    for (int c = 0; c < NB_COUNTERS; c++)
+      if (threads[t].fd[c] < 0)
+        mask &= ~(1U << c);
+
+  if (mask == 0)
+    exit_with_error ("No hardware counter available (see "
+                     "/proc/sys/kernel/perf_event_paranoid)");
+
+  for (int c = 0; c < NB_COUNTERS; c++)
+    if (!(mask & (1U << c)))
+      PRINT_MASTER ("Warning: hardware counter %s is not available\n",
+                    counter_names[c]);
+
+  available = mask;
+}
+
+void perfcounter_finalize (void)
+{
+  if (threads == NULL)
+    return;
+
+  for (int t = 0; t < nb_threads; t++)
+    for (int c = 0; c < NB_COUNTERS; c++)
+      if (threads[t].fd[c] >= 0)
+        close (threads[t].fd[c]);
+
+  free (threads);
+  threads = NULL;
+}
+
+unsigned perfcounter_available (void)
+{
+  return available;
+}
+
+void perfcounter_reset (void)
+{
+  for (int t = 0; t < nb_threads; t++)
+    if (threads[t].leader >= 0)
+      ioctl (threads[t].leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+}
+
+// Group values come in the order counters were successfully opened
+static void read_thread (unsigned t, perfcounter_values_t *v)
+{
+  uint64_t buf[1 + NB_COUNTERS];
+  int i = 1;
+
+  if (read (threads[t].leader, buf, sizeof (buf)) <
+      (ssize_t)sizeof (uint64_t))
+    exit_with_error ("Cannot read hardware counters (%s)", strerror (errno));
+
+  for (int c = 0; c < NB_COUNTERS; c++)
+    if (threads[t].fd[c] >= 0) {
+      v->value[c] = (available & (1U << c)) ? buf[i] : 0;
+      i++;
+    } else
+      v->value[c] = 0;
+}
+
+void perfcounter_read_total (perfcounter_values_t *v)
+{
+  perfcounter_values_t tv;
+
+  memset (v, 0, sizeof (*v));
+
+  for (int t = 0; t < nb_threads; t++) {
+    read_thread (t, &tv);
+    for (int c = 0; c < NB_COUNTERS; c++)
+      v->value[c] += tv.value[c];
+  }
+}
+
+void perfcounter_start_tile (unsigned cpu)
+{
+  if (cpu < nb_threads)
+    read_thread (cpu, &threads[cpu].tile_start);
+}
+
+void perfcounter_end_tile (unsigned cpu, perfcounter_values_t *v)
+{
+  if (cpu >= nb_threads) {
+    memset (v, 0, sizeof (*v));
+    return;
+  }
+
+  read_thread (cpu, v);
+  for (int c = 0; c < NB_COUNTERS; c++)
+    v->value[c] -= threads[cpu].tile_start.value[c];
+}
+
+void perfcounter_start_iteration (void)
+{
+  perfcounter_read_total (&iteration_start);
+}
+
+void perfcounter_end_iteration (perfcounter_values_t *v)
+{
+  perfcounter_read_total (v);
+  for (int c = 0; c < NB_COUNTERS; c++)
+    v->value[c] -= iteration_start.value[c];
+}
+
+#else
+
+void perfcounter_init (void)
+{
+  exit_with_error ("Hardware counters require Linux (perf_event_open)");
+}
+
+void perfcounter_finalize (void)
+{
+}
+
+unsigned perfcounter_available (void)
+{
+  return 0;
+}
+
+void perfcounter_reset (void)
+{
+}
+
+void perfcounter_read_total (perfcounter_values_t *v)
+{
+  memset (v, 0, sizeof (*v));
+}
+
+void perfcounter_start_tile (unsigned cpu)
+{
+}
+
+void perfcounter_end_tile (unsigned cpu, perfcounter_values_t *v)
+{
+  memset (v, 0, sizeof (*v));
+}
+
+void perfcounter_start_iteration (void)
+{
+}
+
+void perfcounter_end_iteration (perfcounter_values_t *v)
+{
+  memset (v, 0, sizeof (*v));
+}
+
+#endif
@@ -0,0 +1,330 @@
+#include "pipeline.h"
+#include "debug.h"
+#include "error.h"
+#include "global.h"
+#include "hooks.h"
+#include "img_data.h"
+#include "monitoring.h"
+
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct
+{
+  char *name;
+  char *param;
+  pipeline_stage_t info;
+  tile_func_t tile, generic_tile;
+  draw_func_t config, draw;
+  void_func_t init, finalize, tile_check;
+} stage_t;
+
+// Consecutive stages run during the same sweep over the image: 'nb_inplace'
+// pointwise or block stages starting at 'first', optionally followed by
+// stage 'stencil'
+typedef struct
+{
+  int first, nb_inplace, stencil;
+} segment_t;
+
+static stage_t stages[PIPELINE_MAX_STAGES];
+static int nb_stages = 0;
+
+static segment_t segments[PIPELINE_MAX_STAGES];
+static int nb_segments = 0;
+
+static void *find_hook (char *kernel, char *hook, char *suffix)
+{
+  char buffer[1024];
+
+  if (suffix != NULL)
+    sprintf (buffer, "%s_%s_%s", kernel, hook, suffix);
+  else
+    sprintf (buffer, "%s_%s", kernel, hook);
+
+  void *fun = hooks_find_symbol (buffer);
+  if (fun != NULL)
+    PRINT_DEBUG ('c', "Found [%s]\n", buffer);
+
+  return fun;
+}
+
+// Splits str in place at each '+' (empty fields are kept) and returns the
+// number of fields
+static int split_fields (char *str, char *fields[], int max)
+{
+  int n = 0;
+
+  for (;;) {
+    char *plus = strchr (str, '+');
+
+    if (n == max)
+      exit_with_error ("Pipelines cannot exceed %d stages", max);
+
+    fields[n++] = str;
+    if (plus == NULL)
+      break;
+    *plus = '\0';
+    str   = plus + 1;
+  }
+
+  return n;
+}
+
+static void build_segments (int fused)
+{
+  segment_t cur = {0, 0, -1};
+
+  nb_segments = 0;
+
+  for (int s = 0; s < nb_stages; s++) {
+    if (stages[s].info.kind == PIPELINE_STENCIL) {
+      // Without fusion, a stencil stage runs alone
+      if (!fused && cur.nb_inplace > 0) {
+        segments[nb_segments++] = cur;
+        cur                     = (segment_t){s, 0, -1};
+      }
+      cur.stencil             = s;
+      segments[nb_segments++] = cur;
+      cur                     = (segment_t){s + 1, 0, -1};
+    } else {
+      if (!fused && cur.nb_inplace > 0) {
+        segments[nb_segments++] = cur;
+        cur                     = (segment_t){s, 0, -1};
+      }
+      cur.nb_inplace++;
+    }
+  }
+
+  if (cur.nb_inplace > 0)
+    segments[nb_segments++] = cur;
+}
+
+static void run_inplace_stages (segment_t *seg, int x, int y)
+{
+  for (int s = seg->first; s < seg->first + seg->nb_inplace; s++)
+    if (stages[s].info.kind == PIPELINE_BLOCK) {
+      const int b = stages[s].info.size;
+
+      for (int i = y; i < y + TILE_H; i += b)
+        for (int j = x; j < x + TILE_W; j += b)
+          stages[s].tile (j, i, b, b);
+    } else
+      stages[s].tile (x, y, TILE_W, TILE_H);
+}
+
+static void run_tile (segment_t *seg, int inplace, int stencil, int x, int y)
+{
+  monitoring_start_tile (omp_get_thread_num ());
+
+  if (inplace)
+    run_inplace_stages (seg, x, y);
+  if (stencil)
+    stages[seg->stencil].tile (x, y, TILE_W, TILE_H);
+
+  monitoring_end_tile (x, y, TILE_W, TILE_H, omp_get_thread_num ());
+}
+
+// Must be called by all threads of the team
+static void run_segment (segment_t *seg)
+{
+  if (seg->stencil == -1 || seg->nb_inplace == 0) {
+#pragma omp for collapse(2) schedule(runtime)
+    for (int y = 0; y < DIM; y += TILE_H)
+      for (int x = 0; x < DIM; x += TILE_W)
+        run_tile (seg, seg->nb_inplace > 0, seg->stencil != -1, x, y);
+  } else {
+    // The stencil stage may only run on tile row r once in-place stages
+    // have completed on rows r - 1, r and r + 1. We sweep rows of tiles
+    // with a lag of two rows between in-place stages and the stencil, so
+    // that a single barrier per row is needed while rows are still hot
+    // in cache.
+    for (int r = 0; r < NB_TILES_Y + 2; r++) {
+#pragma omp for schedule(runtime)
+      for (int x = 0; x < DIM; x += TILE_W) {
+        if (r < NB_TILES_Y)
+          run_tile (seg, 1, 0, x, r * TILE_H);
+        if (r >= 2)
+          run_tile (seg, 0, 1, x, (r - 2) * TILE_H);
+      }
+    }
+  }
+
+  if (seg->stencil != -1) {
+#pragma omp single
+    swap_images ();
+  }
+}
+
+static unsigned pipeline_compute (unsigned nb_iter, int parallel)
+{
+  for (unsigned it = 1; it <= nb_iter; it++) {
+#pragma omp parallel if (parallel)
+    for (int s = 0; s < nb_segments; s++)
+      run_segment (segments + s);
+  }
+
+  return 0;
+}
+
+// Stages are applied one after the other, with one full sweep per stage
+static unsigned pipeline_compute_seq (unsigned nb_iter)
+{
+  return pipeline_compute (nb_iter, 0);
+}
+
+static unsigned pipeline_compute_omp_staged (unsigned nb_iter)
+{
+  return pipeline_compute (nb_iter, 1);
+}
+
+// Consecutive stages are fused tile-by-tile
+static unsigned pipeline_compute_omp_tiled (unsigned nb_iter)
+{
+  return pipeline_compute (nb_iter, 1);
+}
+
+static void pipeline_config (char *param)
+{
+  char *fields[PIPELINE_MAX_STAGES];
+  int n = 0;
+
+  // Parameters are given to stages in order, e.g. -a "+8+16"
+  if (param != NULL)
+    n = split_fields (strdup (param), fields, PIPELINE_MAX_STAGES);
+  if (n > nb_stages)
+    exit_with_error ("Too many parameters (%d) for %d pipeline stages", n,
+                     nb_stages);
+
+  for (int s = 0; s < nb_stages; s++) {
+    stages[s].param = (s < n && fields[s][0] != '\0') ? fields[s] : NULL;
+
+    if (stages[s].config != NULL)
+      stages[s].config (stages[s].param);
+  }
+}
+
+static void pipeline_tile_check (void)
+{
+  pipeline_stage_func_t describe;
+  tile_func_t specialized;
+
+  for (int s = 0; s < nb_stages; s++) {
+    describe = find_hook (stages[s].name, "pipeline", "stage");
+    describe (&stages[s].info);
+
+    if (stages[s].info.kind == PIPELINE_BLOCK &&
+        (TILE_W % stages[s].info.size || TILE_H % stages[s].info.size))
+      exit_with_error ("Tiles (%dx%d) must be made of [%s] blocks (%d)",
+                       TILE_W, TILE_H, stages[s].name, stages[s].info.size);
+
+    if (stages[s].info.kind == PIPELINE_STENCIL &&
+        stages[s].info.size > TILE_H)
+      exit_with_error ("Tile height (%d) must be at least [%s] radius (%d)",
+                       TILE_H, stages[s].name, stages[s].info.size);
+
+    if (stages[s].tile_check != NULL)
+      stages[s].tile_check ();
+
+    // Tile size may have changed since the last call (see --autotune)
+    specialized    = hooks_find_specialized_tile (stages[s].name, tile_name);
+    stages[s].tile = specialized ?: stages[s].generic_tile;
+  }
+
+  build_segments (the_compute == pipeline_compute_omp_tiled);
+
+  PRINT_DEBUG ('c', "Pipeline of %d stages runs in %d sweeps\n", nb_stages,
+               nb_segments);
+}
+
+static void pipeline_init (void)
+{
+  for (int s = 0; s < nb_stages; s++)
+    if (stages[s].init != NULL)
+      stages[s].init ();
+}
+
+static void pipeline_draw (char *param)
+{
+  for (int s = 0; s < nb_stages; s++)
+    if (stages[s].draw != NULL)
+      stages[s].draw (stages[s].param);
+}
+
+static void pipeline_finalize (void)
+{
+  for (int s = 0; s < nb_stages; s++)
+    if (stages[s].finalize != NULL)
+      stages[s].finalize ();
+}
+
+int pipeline_establish_bindings (void)
+{
+  char *names[PIPELINE_MAX_STAGES];
+  int has_draw = 0;
+
+  if (strchr (kernel_name, '+') == NULL)
+    return 0;
+
+  if (opencl_used)
+    exit_with_error ("Pipelines of kernels are not available with OpenCL");
+
+  nb_stages = split_fields (strdup (kernel_name), names, PIPELINE_MAX_STAGES);
+
+  for (int s = 0; s < nb_stages; s++) {
+    stage_t *st = stages + s;
+
+    st->name = names[s];
+    hooks_load_kernel (st->name);
+
+    if (find_hook (st->name, "pipeline", "stage") == NULL)
+      exit_with_error ("Kernel [%s] cannot be used as a pipeline stage (no "
+                       "%s_pipeline_stage function)",
+                       st->name, st->name);
+
+    st->tile = NULL;
+    if (tile_name != NULL)
+      st->tile = find_hook (st->name, "do_tile", tile_name);
+    if (st->tile == NULL)
+      st->tile = find_hook (st->name, "do_tile", "default");
+    if (st->tile == NULL)
+      exit_with_error ("Cannot resolve function [%s_do_tile_default]",
+                       st->name);
+    st->generic_tile = st->tile;
+
+    st->config     = find_hook (st->name, "config", NULL);
+    st->init       = find_hook (st->name, "init", NULL);
+    st->draw       = find_hook (st->name, "draw", NULL);
+    st->finalize   = find_hook (st->name, "finalize", NULL);
+    st->tile_check = find_hook (st->name, "tile_check", tile_name);
+
+    has_draw |= (st->draw != NULL);
+  }
+
+  if (!strcmp (variant_name, "seq"))
+    the_compute = pipeline_compute_seq;
+  else if (!strcmp (variant_name, "omp_staged"))
+    the_compute = pipeline_compute_omp_staged;
+  else if (!strcmp (variant_name, "omp_tiled"))
+    the_compute = pipeline_compute_omp_tiled;
+  else
+    exit_with_error ("Pipeline variant must be seq, omp_staged or omp_tiled "
+                     "(%s)",
+                     variant_name);
+
+  the_config      = pipeline_config;
+  the_tile_check  = pipeline_tile_check;
+  the_init        = pipeline_init;
+  the_draw        = has_draw ? pipeline_draw : NULL;
+  the_finalize    = pipeline_finalize;
+  the_refresh_img = NULL;
+  the_period      = NULL;
+  the_first_touch = NULL;
+
+  if (tile_name == NULL)
+    tile_name = "default";
+
+  return 1;
+}
@@ -0,0 +1,78 @@
+#include <string.h>
+
+#include "error.h"
+#include "global.h"
+#include "sat.h"
+#include "vec_aligned_alloc.h"
+
+// Columns are processed by chunks of this width during the vertical pass
+#define COLUMN_CHUNK 256
+
+void sat_init (sat_t *sat)
+{
+  size_t size = (DIM + 1) * (DIM + 1) * sizeof (uint32_t);
+
+  sat->dim = DIM;
+  for (int p = 0; p < SAT_NB_PLANES; p++) {
+    sat->plane[p] = vec_aligned_malloc (size);
+    // First row and first column remain zero
+    memset (sat->plane[p], 0, size);
+  }
+}
+
+void sat_free (sat_t *sat)
+{
+  for (int p = 0; p < SAT_NB_PLANES; p++)
+    if (sat->plane[p] != NULL) {
+      vec_aligned_free (sat->plane[p]);
+      sat->plane[p] = NULL;
+    }
+}
+
+void sat_build (sat_t *sat, uint32_t *img)
+{
+  const int dim = sat->dim;
+
+  if (dim != DIM)
+    exit_with_error ("Summed-area tables were built for DIM=%d (now %d)", dim,
+                     DIM);
+
+#pragma omp parallel
+  {
+    // Horizontal pass: prefix sums along each row, rows in parallel
+#pragma omp for schedule(static)
+    for (int i = 0; i < dim; i++) {
+      uint32_t r = 0, g = 0, b = 0, a = 0;
+      uint32_t *pr = sat_cell (sat, SAT_RED, i + 1, 1);
+      uint32_t *pg = sat_cell (sat, SAT_GREEN, i + 1, 1);
+      uint32_t *pb = sat_cell (sat, SAT_BLUE, i + 1, 1);
+      uint32_t *pa = sat_cell (sat, SAT_ALPHA, i + 1, 1);
+
+      for (int j = 0; j < dim; j++) {
+        uint32_t c = img[i * dim + j];
+
+        pr[j] = r += extract_red (c);
+        pg[j] = g += extract_green (c);
+        pb[j] = b += extract_blue (c);
+        pa[j] = a += extract_alpha (c);
+      }
+    }
+
+    // Vertical pass: prefix sums along columns, chunks of columns in
+    // parallel (the inner loop is vectorized across columns)
+#pragma omp for collapse(2) schedule(static)
+    for (int p = 0; p < SAT_NB_PLANES; p++)
+      for (int x = 1; x <= dim; x += COLUMN_CHUNK) {
+        const int end = (x + COLUMN_CHUNK <= dim + 1) ? x + COLUMN_CHUNK
+                                                       : dim + 1;
+
+        for (int i = 2; i <= dim; i++) {
+          uint32_t *restrict cur  = sat_cell (sat, p, i, 0);
+          uint32_t *restrict prev = sat_cell (sat, p, i - 1, 0);
+
+          for (int j = x; j < end; j++)
+            cur[j] += prev[j];
+        }
+      }
+  }
+}
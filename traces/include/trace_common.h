@@ -7,23 +7,33 @@
 extern unsigned cpu_colors[];
 extern unsigned gpu_index[];
 
-#define TRACE_BEGIN_ITER   0x101
-#define TRACE_BEGIN_TILE   0x102
-#define TRACE_END_TILE     0x103
-#define TRACE_NB_THREADS   0x104
-#define TRACE_NB_ITER      0x105
-#define TRACE_DIM          0x106
-#define TRACE_END_ITER     0x107
-#define TRACE_LABEL        0x108
-#define TRACE_TASKID_COUNT 0x109
-#define TRACE_TASKID       0x10A
-#define TRACE_FIRST_ITER   0x10B
+#define TRACE_BEGIN_ITER    0x101
+#define TRACE_BEGIN_TILE    0x102
+#define TRACE_END_TILE      0x103
+#define TRACE_NB_THREADS    0x104
+#define TRACE_NB_ITER       0x105
+#define TRACE_DIM           0x106
+#define TRACE_END_ITER      0x107
+#define TRACE_LABEL         0x108
+#define TRACE_TASKID_COUNT  0x109
+#define TRACE_TASKID        0x10A
+#define TRACE_FIRST_ITER    0x10B
+#define TRACE_COUNTERS      0x10C
+#define TRACE_TILE_COUNTERS 0x10D
+#define TRACE_ITER_COUNTERS 0x10E
+#define TRACE_ITER_SUMMARY  0x10F
 
 #define DEFAULT_EZV_TRACE_DIR "traces/data"
 #define DEFAULT_EZV_TRACE_BASE "ezv_trace_current"
-#define DEFAULT_EZV_TRACE_EXT  ".evt"
+#define DEFAULT_EZV_TRACE_EXT  ".ezt"
 #define DEFAULT_EZV_TRACE_FILE DEFAULT_EZV_TRACE_BASE DEFAULT_EZV_TRACE_EXT
 #define DEFAULT_EASYVIEW_FILE DEFAULT_EZV_TRACE_DIR "/" DEFAULT_EZV_TRACE_FILE
+// FxT traces (see --trace-fxt)
+#define DEFAULT_EZV_FXT_EXT  ".evt"
+#define DEFAULT_EZV_FXT_FILE DEFAULT_EZV_TRACE_BASE DEFAULT_EZV_FXT_EXT
+// Live traces (see --trace-live)
+#define DEFAULT_EZV_LIVE_EXT  ".sock"
+#define DEFAULT_EZV_LIVE_FILE DEFAULT_EZV_TRACE_BASE DEFAULT_EZV_LIVE_EXT
 
 typedef enum {
     TASK_TYPE_COMPUTE,
@@ -31,6 +41,25 @@ typedef enum {
     TASK_TYPE_READ
 } task_type_t;
 
+// Hardware counters (see --perf-counters). A trace holding counters
+// declares the available ones with a TRACE_COUNTERS event (bit mask), then
+// each TRACE_END_TILE (resp. TRACE_END_ITER) event is preceded by a
+// TRACE_TILE_COUNTERS (resp. TRACE_ITER_COUNTERS) event.
+// Sampling (see --trace-every, --trace-tiles and --trace-budget): only some
+// tiles are recorded, but each TRACE_END_ITER event is preceded by a
+// TRACE_ITER_SUMMARY event (number of tiles, number of recorded tiles, sum
+// of tile durations of all lanes).
+
+typedef enum {
+    COUNTER_CYCLES,
+    COUNTER_INSTRUCTIONS,
+    COUNTER_LLC_MISSES,
+    COUNTER_BRANCH_MISSES,
+    NB_COUNTERS
+} counter_t;
+
+extern char *counter_names[NB_COUNTERS];
+
 #define TASK_TYPE_BITS 2U
 
 #define TASK_COMBINE(ttype,tid) ((unsigned)(ttype) | ((unsigned)(tid) << TASK_TYPE_BITS))
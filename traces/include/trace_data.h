@@ -1,25 +1,32 @@
 #ifndef TRACE_DATA_IS_DEF
 #define TRACE_DATA_IS_DEF
 
-#include "list.h"
+#include <stdint.h>
+
 #include "trace_common.h"
 
+// Tasks executed by a CPU (or GPU lane) are stored by increasing start time,
+// one array per field, so that tasks are addressed by their index
 typedef struct
 {
-  long start_time, end_time;
-  unsigned x, y, w, h;
-  int task_type;
-  int task_id;
-  unsigned iteration;
-  struct list_head cpu_chain;
-} trace_task_t;
+  unsigned nb_tasks, capacity;
+  long *start_time, *end_time;
+  unsigned *x, *y, *w, *h;
+  uint8_t *task_type;
+  int *task_id;
+  unsigned *iteration;
+  uint64_t *counters; // NB_COUNTERS per task, NULL if the trace holds none
+} trace_cpu_t;
 
 typedef struct
 {
   long start_time, end_time;
   long correction, gap;
-  struct list_head chain;
-  trace_task_t **first_cpu_task;
+  uint64_t counters[NB_COUNTERS];
+  // See TRACE_ITER_SUMMARY (nb_tiles is 0 if the trace holds no summary)
+  unsigned long nb_tiles, nb_sampled;
+  long busy_time;
+  unsigned *first_cpu_task; // index of the first task of each CPU
 } trace_iteration_t;
 
 typedef struct
@@ -33,11 +40,13 @@ typedef struct
   char *label;
   char **task_ids;
   unsigned task_ids_count;
-  struct list_head *per_cpu;
+  unsigned counters_mask; // available hardware counters (0 if none)
+  uint64_t counters[NB_COUNTERS]; // sum over all iterations
+  trace_cpu_t *per_cpu;
   trace_iteration_t *iteration;
 } trace_t;
 
-#define MAX_TRACES 2
+#define MAX_TRACES 8
 
 extern trace_t trace[MAX_TRACES];
 extern unsigned nb_traces;
@@ -53,22 +62,51 @@ void trace_data_set_label (trace_t *tr, char *label);
 void trace_data_alloc_task_ids (trace_t *tr, unsigned count);
 void trace_data_add_taskid (trace_t *tr, char *id);
 
+void trace_data_set_counters (trace_t *tr, unsigned mask);
+
 void trace_data_add_task (trace_t *tr, long start_time, long end_time,
                           unsigned x, unsigned y, unsigned w, unsigned h,
                           unsigned iteration, unsigned cpu,
-                          task_type_t task_type, int task_id);
+                          task_type_t task_type, int task_id,
+                          uint64_t *counters);
 
 void trace_data_start_iteration (trace_t *tr, long start_time);
 void trace_data_end_iteration (trace_t *tr, long end_time);
+void trace_data_iteration_counters (trace_t *tr, uint64_t *counters);
+void trace_data_iteration_summary (trace_t *tr, unsigned long nb_tiles,
+                                   unsigned long nb_sampled, long busy_time);
 
 void trace_data_no_more_data (trace_t *tr);
+// Forgets the n first iterations (live traces keep a bounded window)
+void trace_data_drop_iterations (trace_t *tr, unsigned n);
+
+// Traces decoded on demand (see trace_file_fetch_iterations) only hold the
+// tasks of a range of iterations. trace_data_forget_tasks drops all tasks,
+// then the tasks of each iteration of the new range are appended between
+// trace_data_reload_start and trace_data_reload_end. start_time is the
+// iteration start, as recorded.
+void trace_data_forget_tasks (trace_t *tr);
+void trace_data_reload_start (trace_t *tr, unsigned it, long start_time);
+void trace_data_reload_end (trace_t *tr, unsigned it);
 
 void trace_data_sync_iterations (void);
 
 void trace_data_finalize (void);
 
 #define for_all_tasks(tr, cpu, var)                                            \
-  list_for_each_entry (trace_task_t, var, (tr)->per_cpu + (cpu), cpu_chain)
+  for (unsigned var = 0; var < (tr)->per_cpu[cpu].nb_tasks; var++)
+
+// Index following the last task executed by cpu during iteration it
+#define iteration_tasks_end(tr, cpu, it)                                       \
+  ((it) + 1 < (tr)->nb_iterations                                              \
+       ? (tr)->iteration[(it) + 1].first_cpu_task[cpu]                         \
+       : (tr)->per_cpu[cpu].nb_tasks)
+
+// Tasks executed by cpu during iteration it
+#define for_iteration_tasks(tr, cpu, it, var)                                  \
+  for (unsigned var = (tr)->iteration[it].first_cpu_task[cpu],                 \
+                var##_end = iteration_tasks_end (tr, cpu, it);                 \
+       var < var##_end; var++)
 
 int trace_data_search_iteration (trace_t *tr, long t);
 int trace_data_search_next_iteration (trace_t *tr, long t);
@@ -85,14 +123,15 @@ int trace_data_search_prev_iteration (trace_t *tr, long t);
              (tr)->iteration[it].gap                                           \
        : (tr)->iteration[it].end_time)
 
-#define task_start_time(tr, t)                                                 \
+// c points to a trace_cpu_t, i is the index of the task
+#define task_start_time(tr, c, i)                                              \
   (trace_data_align_mode                                                       \
-       ? (t)->start_time + (tr)->iteration[(t)->iteration].correction          \
-       : (t)->start_time)
+       ? (c)->start_time[i] + (tr)->iteration[(c)->iteration[i]].correction    \
+       : (c)->start_time[i])
 
-#define task_end_time(tr, t)                                                   \
+#define task_end_time(tr, c, i)                                                \
   (trace_data_align_mode                                                       \
-       ? (t)->end_time + (tr)->iteration[(t)->iteration].correction            \
-       : (t)->end_time)
+       ? (c)->end_time[i] + (tr)->iteration[(c)->iteration[i]].correction      \
+       : (c)->end_time[i])
 
 #endif
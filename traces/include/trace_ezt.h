@@ -0,0 +1,157 @@
+#ifndef TRACE_EZT_IS_DEF
+#define TRACE_EZT_IS_DEF
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "trace_common.h"
+
+// Native trace format (.ezt). All integers are little-endian.
+//
+//   ezt_header_t
+//   strings       label then task ids, NUL-terminated, padded to 8 bytes
+//   iterations    ezt_iteration_t [nb_iterations]
+//   lanes         ezt_lane_t [nb_lanes]
+//   index         ezt_index_t [nb_lanes][nb_iterations + 1]
+//   streams       per lane, one byte stream per column (see below)
+//
+// Tasks of each lane are stored column by column, as varints:
+//   EZT_STREAM_TIME     start (zigzag delta from the end of the previous
+//                       task, or from the iteration start for the first task
+//                       of an iteration), then duration
+//   EZT_STREAM_TILE     x, y, w, h
+//   EZT_STREAM_TASK     TASK_COMBINE (type, id)
+//   EZT_STREAM_COUNTERS NB_COUNTERS values (empty if counters_mask == 0)
+//
+// index[l][i] gives the number of tasks of lane l before iteration i and the
+// position of its first task in each stream, so that any iteration can be
+// decoded without decoding the previous ones.
+
+#define EZT_MAGIC "EZT1"
+#define EZT_VERSION 2
+
+enum
+{
+  EZT_STREAM_TIME,
+  EZT_STREAM_TILE,
+  EZT_STREAM_TASK,
+  EZT_STREAM_COUNTERS,
+  EZT_NB_STREAMS
+};
+
+typedef struct
+{
+  char magic[4];
+  uint32_t version;
+  uint32_t nb_cores, nb_gpu; // nb_gpu counts GPU lanes (2 per GPU)
+  uint32_t dim;
+  uint32_t first_iteration;
+  uint32_t nb_iterations;
+  uint32_t counters_mask;
+  uint32_t task_ids_count;
+  uint32_t strings_size; // padding excluded
+  uint64_t nb_tasks;
+} ezt_header_t;
+
+typedef struct
+{
+  int64_t start_time, end_time;
+  uint64_t counters[NB_COUNTERS];
+  uint64_t nb_tiles, nb_sampled, busy_time; // see TRACE_ITER_SUMMARY
+} ezt_iteration_t;
+
+typedef struct
+{
+  uint64_t nb_tasks;
+  uint64_t offset[EZT_NB_STREAMS]; // from the beginning of the file
+  uint64_t size[EZT_NB_STREAMS];
+} ezt_lane_t;
+
+typedef struct
+{
+  uint64_t first_task;
+  uint64_t offset[EZT_NB_STREAMS]; // from the beginning of the stream
+} ezt_index_t;
+
+#define EZT_PAD8(n) (((n) + 7) & ~(size_t)7)
+
+// Varints store 7 bits per byte, least significant bits first
+static inline size_t ezt_put_varint (uint8_t *p, uint64_t v)
+{
+  size_t n = 0;
+
+  while (v >= 0x80) {
+    p[n++] = (uint8_t)v | 0x80;
+    v >>= 7;
+  }
+  p[n++] = (uint8_t)v;
+
+  return n;
+}
+
+static inline uint64_t ezt_get_varint (const uint8_t **p)
+{
+  uint64_t v = 0;
+  unsigned shift = 0;
+  uint8_t b;
+
+  do {
+    b = *(*p)++;
+    v |= (uint64_t)(b & 0x7F) << shift;
+    shift += 7;
+  } while (b & 0x80);
+
+  return v;
+}
+
+static inline uint64_t ezt_zigzag (int64_t v)
+{
+  return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static inline int64_t ezt_unzigzag (uint64_t v)
+{
+  return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+// Reading (easyview): files are mapped in memory and decoded on demand
+
+typedef struct
+{
+  void *base;
+  size_t size;
+  const ezt_header_t *header;
+  const char *strings;
+  const ezt_iteration_t *iterations;
+  const ezt_lane_t *lanes;
+  const ezt_index_t *index;
+} ezt_file_t;
+
+typedef struct
+{
+  long start_time, end_time;
+  unsigned x, y, w, h;
+  unsigned task; // see TASK_EXTRACT_TTYPE and TASK_EXTRACT_TID
+  uint64_t counters[NB_COUNTERS];
+} ezt_task_t;
+
+typedef struct
+{
+  const uint8_t *p[EZT_NB_STREAMS];
+  uint64_t remaining;
+  int64_t prev;
+  int has_counters;
+} ezt_cursor_t;
+
+// Returns 1 if file starts with EZT_MAGIC
+int ezt_file_is_native (char *file);
+void ezt_file_open (ezt_file_t *f, char *file);
+void ezt_file_close (ezt_file_t *f);
+
+// Tasks executed by lane during iteration it
+void ezt_cursor_init (ezt_file_t *f, ezt_cursor_t *c, unsigned lane,
+                      unsigned it);
+// Returns 0 once all tasks have been read
+int ezt_cursor_next (ezt_cursor_t *c, ezt_task_t *t);
+
+#endif
@@ -3,6 +3,20 @@
 
 #include "trace_data.h"
 
+// Do not report loaded traces on stdout
+extern unsigned trace_file_quiet;
+
 void trace_file_load  (char *file);
+// Loads n traces in parallel (one thread per file)
+void trace_file_load_all (char *files[], unsigned n);
+
+// Makes sure the tasks of iterations [first, last] of tr are in memory.
+// Native traces are decoded on demand and only hold the tasks of the last
+// fetched range: if some of the iterations are missing, tasks of
+// [first - margin, last + margin] are decoded and replace the previous ones,
+// so that task indexes are only valid until the next call. Other traces
+// hold all their tasks.
+void trace_file_fetch_iterations (trace_t *tr, unsigned first, unsigned last,
+                                  unsigned margin);
 
 #endif
\ No newline at end of file
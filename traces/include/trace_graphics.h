@@ -26,6 +26,9 @@ void trace_graphics_toggle_vh_mode (void);
 void trace_graphics_toggle_tracking_mode (void);
 void trace_graphics_toggle_footprint_mode (void);
 
+// Live traces received new iterations, after dropping the first ones
+void trace_graphics_live_update (unsigned dropped);
+
 extern int use_thumbnails;
 extern unsigned char brightness;
 extern unsigned soft_rendering;
@@ -0,0 +1,44 @@
+#ifndef TRACE_LIVE_IS_DEF
+#define TRACE_LIVE_IS_DEF
+
+#include <stdint.h>
+
+#include "trace_ezt.h"
+
+// Live traces (easypap --trace-live, easyview --live)
+//
+// easypap listens on a Unix socket and easyview connects to it at any time
+// during the run. Upon connection, easypap sends an ezt_header_t (where
+// first_iteration is the next iteration to be traced, nb_iterations and
+// nb_tasks are 0) followed by the strings of the header (see trace_ezt.h,
+// without padding). Then, at the end of each iteration, the events of the
+// iteration are sent as ezt_live_event_t records, in time order.
+//
+// Events are dropped while no viewer is connected, so that easypap only
+// buffers one iteration. A slow viewer slows easypap down.
+
+typedef struct
+{
+  int64_t time;
+  uint32_t code; // TRACE_BEGIN_ITER, TRACE_END_TILE, ... (trace_common.h)
+  uint32_t lane;
+  // TRACE_END_TILE: x | y << 32, w | h << 32, TASK_COMBINE (type, id)
+  // TRACE_TILE_COUNTERS, TRACE_ITER_COUNTERS: NB_COUNTERS values
+  // TRACE_ITER_SUMMARY: nb_tiles, nb_sampled, busy_time
+  uint64_t param[4];
+} ezt_live_event_t;
+
+// Viewer side
+
+// Iterations kept in memory: older ones are dropped (see --live-window)
+extern unsigned trace_live_window;
+
+// Connects to the socket and initializes a new trace from its header
+void trace_live_connect (char *socket_path);
+// Ingests pending events (waiting for at least one if blocking is set).
+// Returns the number of completed iterations ingested, or -1 once the
+// recording process is gone. *dropped is set to the number of iterations
+// dropped from the beginning of the trace.
+int trace_live_poll (int blocking, unsigned *dropped);
+
+#endif
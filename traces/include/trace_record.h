@@ -1,6 +1,8 @@
 #ifndef TRACE_RECORD_IS_DEF
 #define TRACE_RECORD_IS_DEF
 
+#include <stdint.h>
+
 #include "trace_common.h"
 
 #ifdef ENABLE_TRACE
@@ -20,6 +22,17 @@ void __trace_record_end_tile (long time, unsigned cpu, unsigned x, unsigned y,
                               int task_id);
 void trace_record_finalize (void);
 
+// Records one iteration out of every, a tile_ratio fraction of tiles (drawn
+// at random) and no tile starting more than budget µs after the beginning
+// of its iteration (0 = no limit)
+void trace_record_set_sampling (unsigned every, double tile_ratio,
+                                long budget);
+
+// Hardware counters, see perfcounter.h
+void trace_record_declare_counters (unsigned mask);
+void __trace_record_tile_counters (unsigned cpu, uint64_t values[]);
+void __trace_record_iteration_counters (uint64_t values[]);
+
 #define trace_record_start_iteration(t)                                        \
   do {                                                                         \
     if (do_trace)                                                              \
@@ -44,6 +57,18 @@ void trace_record_finalize (void);
       __trace_record_end_tile ((t), (c), (x), (y), (w), (h), (tt), (tid));     \
   } while (0)
 
+#define trace_record_tile_counters(c, v)                                       \
+  do {                                                                         \
+    if (do_trace)                                                              \
+      __trace_record_tile_counters ((c), (v));                                 \
+  } while (0)
+
+#define trace_record_iteration_counters(v)                                     \
+  do {                                                                         \
+    if (do_trace)                                                              \
+      __trace_record_iteration_counters (v);                                   \
+  } while (0)
+
 #else
 
 #define do_trace (unsigned)0
@@ -54,6 +79,8 @@ void trace_record_finalize (void);
 #define trace_record_end_iteration(t) (void)0
 #define trace_record_start_tile(t, c) (void)0
 #define trace_record_end_tile(t, c, x, y, w, h, tt, tid) (void)0
+#define trace_record_tile_counters(c, v) (void)0
+#define trace_record_iteration_counters(v) (void)0
 
 #endif
 
@@ -0,0 +1,17 @@
+#ifndef TRACE_SIM_IS_DEF
+#define TRACE_SIM_IS_DEF
+
+#include "trace_stats.h"
+
+// Workers (0 = number of CPU lanes of each trace) and chunk size of the
+// dynamic policy (see --sim-workers and --sim-chunk)
+extern unsigned trace_sim_workers;
+extern unsigned trace_sim_chunk;
+
+// Replays the tasks of all loaded traces under several scheduling policies
+// (static, cyclic, dynamic, work stealing) and prints the predicted makespan
+// and load imbalance of each iteration on stdout (see --simulate). Task
+// costs are the recorded durations, tasks are scheduled in tile order.
+void trace_sim_print (stats_format_t format);
+
+#endif
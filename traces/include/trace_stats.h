@@ -0,0 +1,28 @@
+#ifndef TRACE_STATS_IS_DEF
+#define TRACE_STATS_IS_DEF
+
+#include "trace_data.h"
+
+typedef enum
+{
+  STATS_FORMAT_CSV,
+  STATS_FORMAT_JSON
+} stats_format_t;
+
+// Prints scheduling metrics of all loaded traces on stdout (see --stats):
+// per-iteration load imbalance, critical path and speedup bound, per-lane
+// idle ratio and task duration histograms. Times are in µs. Sampled traces
+// also report the number of tiles (all and recorded ones) and the total time
+// spent in tiles. Other metrics are computed on recorded tiles only.
+void trace_stats_print (stats_format_t format);
+
+// Helpers shared by --stats and --simulate outputs
+
+// Writes one CSV row: trace;label;[policy;]metric;index;value (policy is
+// omitted if NULL, index is left empty if has_index is 0)
+void trace_stats_print_csv_row (trace_t *tr, char *policy, char *metric,
+                                long index, int has_index, double value);
+// Writes s as a quoted JSON string
+void trace_stats_print_json_string (const char *s);
+
+#endif
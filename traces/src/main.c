@@ -13,16 +13,28 @@
 #include "trace_file.h"
 #include "trace_graphics.h"
 #include "trace_common.h"
+#include "trace_live.h"
+#include "trace_sim.h"
+#include "trace_stats.h"
 
 static int WINDOW_PREFERRED_WIDTH  = 1920;
 static int WINDOW_PREFERRED_HEIGHT = 1024;
 
-static int first_iteration = -1;
-static int last_iteration  = -1;
-static int whole_trace     = 0;
+static int first_iteration         = -1;
+static int last_iteration          = -1;
+static int whole_trace             = 0;
+static int do_stats                = 0;
+static stats_format_t stats_format = STATS_FORMAT_CSV;
+static int do_sim                  = 0;
+static stats_format_t sim_format   = STATS_FORMAT_CSV;
+static int live                    = 0;
+static int live_window_set         = 0;
+
+// Period (in ms) at which live traces are polled
+#define LIVE_REFRESH_MS 100
 
 static unsigned nb_dir = 0;
-char *trace_dir[MAX_TRACES] = { NULL, NULL };
+char *trace_dir[MAX_TRACES] = { NULL };
 
 static void usage (char *progname, int val)
 {
@@ -34,17 +46,42 @@ static void usage (char *progname, int val)
   fprintf (stderr, "\t-d\t| --dir <dir>\t\t: specify trace directory\n");
   fprintf (stderr, "\t-h\t| --help\t\t: display help\n");
   fprintf (stderr, "\t-i\t| --iteration <i>\t: display iteration i\n");
+  fprintf (stderr, "\t-l\t| --live\t\t: attach to easypap --trace-live\n");
+  fprintf (stderr, "\t-lw\t| --live-window <n>\t: keep the last n live "
+                   "iterations (default %d, 0 = all)\n",
+           trace_live_window);
   fprintf (stderr, "\t-nt\t| --no-thumb\t\t: ignore thumbnails\n");
   fprintf (stderr, "\t-p\t| --params\t\t: use options from params.txt file\n");
   fprintf (stderr,
            "\t-sr\t| --soft-rendering\t: disable hardware acceleration\n");
   fprintf (stderr,
            "\t-r\t| --range <i> <j>\t: display iteration range [i-j]\n");
+  fprintf (stderr, "\t-st\t| --stats <csv|json>\t: print statistics instead "
+                   "of displaying traces\n");
+  fprintf (stderr, "\t-sim\t| --simulate <csv|json>\t: replay traces under "
+                   "several scheduling policies\n");
+  fprintf (stderr, "\t-sw\t| --sim-workers <P>\t: simulate P workers "
+                   "(default: number of CPUs)\n");
+  fprintf (stderr, "\t-sk\t| --sim-chunk <k>\t: use chunks of k tasks with "
+                   "the dynamic policy\n");
   fprintf (stderr, "\t-w\t| --whole-trace\t\t: display all iterations\n");
 
   exit (val);
 }
 
+// Output format of --stats and --simulate
+static stats_format_t parse_format (char *progname, char *arg)
+{
+  if (!strcmp (arg, "csv"))
+    return STATS_FORMAT_CSV;
+  if (!strcmp (arg, "json"))
+    return STATS_FORMAT_JSON;
+
+  fprintf (stderr, "Error: unknown output format \"%s\"\n", arg);
+  usage (progname, 1);
+  return STATS_FORMAT_CSV; // not reached
+}
+
 static char **filter_args (int *argc, char *argv[])
 {
   char *progname = "./view"; // argv [0];
@@ -67,6 +104,53 @@ static char **filter_args (int *argc, char *argv[])
       brightness = atoi (*argv);
     } else if (!strcmp (*argv, "--soft-rendering") || !strcmp (*argv, "-sr")) {
       soft_rendering = 1;
+    } else if (!strcmp (*argv, "--stats") || !strcmp (*argv, "-st")) {
+      if (*argc <= 1) {
+        fprintf (stderr, "Error: parameter (csv or json) missing\n");
+        usage (progname, 1);
+      }
+      (*argc)--;
+      argv++;
+      stats_format     = parse_format (progname, *argv);
+      do_stats         = 1;
+      trace_file_quiet = 1;
+    } else if (!strcmp (*argv, "--simulate") || !strcmp (*argv, "-sim")) {
+      if (*argc <= 1) {
+        fprintf (stderr, "Error: parameter (csv or json) missing\n");
+        usage (progname, 1);
+      }
+      (*argc)--;
+      argv++;
+      sim_format       = parse_format (progname, *argv);
+      do_sim           = 1;
+      trace_file_quiet = 1;
+    } else if (!strcmp (*argv, "--sim-workers") || !strcmp (*argv, "-sw")) {
+      if (*argc <= 1) {
+        fprintf (stderr, "Error: parameter (number) missing\n");
+        usage (progname, 1);
+      }
+      (*argc)--;
+      argv++;
+      trace_sim_workers = atoi (*argv);
+    } else if (!strcmp (*argv, "--sim-chunk") || !strcmp (*argv, "-sk")) {
+      if (*argc <= 1) {
+        fprintf (stderr, "Error: parameter (number) missing\n");
+        usage (progname, 1);
+      }
+      (*argc)--;
+      argv++;
+      trace_sim_chunk = atoi (*argv);
+    } else if (!strcmp (*argv, "--live") || !strcmp (*argv, "-l")) {
+      live = 1;
+    } else if (!strcmp (*argv, "--live-window") || !strcmp (*argv, "-lw")) {
+      if (*argc <= 1) {
+        fprintf (stderr, "Error: parameter (number) missing\n");
+        usage (progname, 1);
+      }
+      (*argc)--;
+      argv++;
+      trace_live_window = atoi (*argv);
+      live_window_set   = 1;
     } else if (!strcmp (*argv, "--whole-trace") || !strcmp (*argv, "-w")) {
       whole_trace = 1;
     } else if (!strcmp (*argv, "--help") || !strcmp (*argv, "-h")) {
@@ -98,7 +182,8 @@ static char **filter_args (int *argc, char *argv[])
       (*argc)--;
       argv++;
       if (nb_dir == MAX_TRACES)
-        exit_with_error ("Cannot not specify more than two traces directories");
+        exit_with_error ("Cannot not specify more than %d traces directories",
+                         MAX_TRACES);
 
       trace_dir[nb_dir++] = *argv;
     } else {
@@ -115,36 +200,71 @@ static char **filter_args (int *argc, char *argv[])
   return argv;
 }
 
+// Builds the name of the default trace of directory dir, falling back to the
+// FxT one
+static void default_trace (char *file, char *dir)
+{
+  sprintf (file, "%s/%s", dir, DEFAULT_EZV_TRACE_FILE);
+  if (access (file, R_OK) != 0)
+    sprintf (file, "%s/%s", dir, DEFAULT_EZV_FXT_FILE);
+}
+
 int main (int argc, char **argv)
 {
+  static char default_file[MAX_TRACES][1024];
+  char *files[MAX_TRACES];
+
   argv = filter_args (&argc, argv);
 
-  switch (argc) {
-  case 0: {
-    char file[1024];
+  if (argc > MAX_TRACES)
+    exit_with_error ("Too many trace files specified (max %d)", MAX_TRACES);
+
+  if (live) {
+    unsigned dropped;
+
+    if (argc > 0)
+      exit_with_error ("--live cannot be used along with trace files");
+
+    sprintf (default_file[0], "%s/%s", trace_dir[0], DEFAULT_EZV_LIVE_FILE);
+    trace_live_connect (default_file[0]);
+    use_thumbnails = 0;
 
-    sprintf (file, "%s/%s", trace_dir[0], DEFAULT_EZV_TRACE_FILE);
-    trace_file_load (file);
+    if (do_stats || do_sim) {
+      // Statistics are computed once the run is over, on the whole run
+      // unless --live-window was given
+      if (!live_window_set)
+        trace_live_window = 0;
 
-    if (trace_dir[1] != NULL) {
-      sprintf (file, "%s/%s", trace_dir[1], DEFAULT_EZV_TRACE_FILE);
-      trace_file_load (file);
+      while (trace_live_poll (1, &dropped) >= 0)
+        ;
+
+      if (trace_live_window)
+        fprintf (stderr, "Live trace: statistics cover iterations %u-%u\n",
+                 trace[0].first_iteration,
+                 trace[0].first_iteration + trace[0].nb_iterations - 1);
+    } else if (trace_live_poll (1, &dropped) < 0)
+      exit_with_error ("easypap stopped before completing an iteration");
+  } else if (argc == 0) {
+    int n = 0;
+
+    while (n < MAX_TRACES && trace_dir[n] != NULL) {
+      default_trace (default_file[n], trace_dir[n]);
+      files[n] = default_file[n];
+      n++;
     }
 
-    break;
-  }
-  case 1: {
-    trace_file_load (argv[0]);
-    break;
-  }
-  case 2: {
-    trace_file_load (argv[0]);
-    trace_file_load (argv[1]);
-    break;
-  }
-  default:
-    exit_with_error ("Too many trace files specified (max %d)", MAX_TRACES);
-  }
+    trace_file_load_all (files, n);
+  } else
+    trace_file_load_all (argv, argc);
+
+  if (do_stats)
+    trace_stats_print (stats_format);
+
+  if (do_sim)
+    trace_sim_print (sim_format);
+
+  if (do_stats || do_sim)
+    return EXIT_SUCCESS;
 
   trace_data_sync_iterations ();
 
@@ -156,10 +276,23 @@ int main (int argc, char **argv)
     trace_graphics_setview (first_iteration, last_iteration);
 
   SDL_Event event;
-  SDL_bool quit = SDL_FALSE;
+  SDL_bool quit         = SDL_FALSE;
+  Uint32 last_live_poll = SDL_GetTicks ();
 
   do {
-    int r = SDL_WaitEvent (&event);
+    int r = live ? SDL_WaitEventTimeout (&event, LIVE_REFRESH_MS)
+                 : SDL_WaitEvent (&event);
+
+    if (live && SDL_GetTicks () - last_live_poll >= LIVE_REFRESH_MS) {
+      unsigned dropped;
+      int n = trace_live_poll (0, &dropped);
+
+      if (n > 0)
+        trace_graphics_live_update (dropped);
+      else if (n < 0)
+        live = 0; // easypap is over
+      last_live_poll = SDL_GetTicks ();
+    }
 
     if (r > 0) {
       if (event.type == SDL_KEYDOWN) {
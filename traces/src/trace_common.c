@@ -24,3 +24,6 @@ unsigned gpu_index[3] = {
     1, // TASK_TYPE_WRITE:   red
     0  // TASK_TYPE_READ:    yellow
 };
+
+char *counter_names[NB_COUNTERS] = {"cycles", "instructions", "llc_misses",
+                                    "branch_misses"};
@@ -12,49 +12,57 @@ trace_t trace[MAX_TRACES];
 unsigned nb_traces             = 0;
 unsigned trace_data_align_mode = 0;
 
+static int next_id[MAX_TRACES] = {0};
+
 #define REMOVE_OVERHEAD
 
 #ifdef REMOVE_OVERHEAD
 
-static long overhead           = 0;
-static long end_last_iteration = 0;
-static long fixed_gap          = 0;
+// Traces may be loaded concurrently: loading state is kept per trace
+static long overhead[MAX_TRACES]           = {0};
+static long end_last_iteration[MAX_TRACES] = {0};
+static long fixed_gap[MAX_TRACES]          = {0};
 
-#define shift(t) ((t)-overhead)
+#define shift(t) ((t)-overhead[tr->num])
 
 #else
 
 #define shift(t) (t)
 #endif
 
-static LIST_HEAD (tmp_list);
-static trace_iteration_t *current_it = NULL;
+static trace_iteration_t *current_it[MAX_TRACES] = {NULL};
+static unsigned iterations_capacity[MAX_TRACES]  = {0};
 
 void trace_data_init (trace_t *tr, unsigned num)
 {
-  overhead           = 0;
-  end_last_iteration = 0;
-  fixed_gap          = 0;
-  current_it         = NULL;
+#ifdef REMOVE_OVERHEAD
+  overhead[num]           = 0;
+  end_last_iteration[num] = 0;
+  fixed_gap[num]          = 0;
+#endif
+  current_it[num]          = NULL;
+  iterations_capacity[num] = 0;
+  next_id[num]             = 0;
 
   tr->num             = num;
   tr->nb_cores        = 1;
   tr->nb_gpu          = 0;
   tr->per_cpu         = NULL;
+  tr->iteration       = NULL;
   tr->nb_iterations   = 0;
   tr->first_iteration = 1;
   tr->label           = NULL;
   tr->task_ids        = NULL;
   tr->task_ids_count  = 0;
+  tr->counters_mask   = 0;
+  memset (tr->counters, 0, sizeof (tr->counters));
 }
 
 void trace_data_set_nb_threads (trace_t *tr, unsigned nb_cores, unsigned nb_gpu)
 {
   tr->nb_cores = nb_cores + nb_gpu;
   tr->nb_gpu   = nb_gpu;
-  tr->per_cpu  = malloc (tr->nb_cores * sizeof (trace_task_t));
-  for (int i = 0; i < tr->nb_cores; i++)
-    INIT_LIST_HEAD (tr->per_cpu + i);
+  tr->per_cpu  = calloc (tr->nb_cores, sizeof (trace_cpu_t));
 }
 
 void trace_data_set_dim (trace_t *tr, unsigned dim)
@@ -73,8 +81,6 @@ void trace_data_set_label (trace_t *tr, char *label)
   strcpy (tr->label, label);
 }
 
-static int next_id[MAX_TRACES] = {0, 0};
-
 void trace_data_alloc_task_ids (trace_t *tr, unsigned count)
 {
   tr->task_ids       = calloc (count, sizeof (char *));
@@ -88,27 +94,71 @@ void trace_data_add_taskid (trace_t *tr, char *id)
   strcpy (tr->task_ids[i], id);
 }
 
+void trace_data_set_counters (trace_t *tr, unsigned mask)
+{
+  tr->counters_mask = mask;
+}
+
+#define grow_column(c, field)                                                  \
+  do {                                                                         \
+    (c)->field = realloc ((c)->field, (c)->capacity * sizeof (*(c)->field));   \
+    if ((c)->field == NULL)                                                    \
+      exit_with_error ("Cannot allocate trace data");                          \
+  } while (0)
+
+static void grow_cpu (trace_t *tr, trace_cpu_t *c)
+{
+  c->capacity = c->capacity ? c->capacity * 2 : 1024;
+
+  grow_column (c, start_time);
+  grow_column (c, end_time);
+  grow_column (c, x);
+  grow_column (c, y);
+  grow_column (c, w);
+  grow_column (c, h);
+  grow_column (c, task_type);
+  grow_column (c, task_id);
+  grow_column (c, iteration);
+
+  if (tr->counters_mask) {
+    c->counters = realloc (c->counters, c->capacity * NB_COUNTERS *
+                                            sizeof (uint64_t));
+    if (c->counters == NULL)
+      exit_with_error ("Cannot allocate trace data");
+  }
+}
+
 void trace_data_add_task (trace_t *tr, long start_time, long end_time,
                           unsigned x, unsigned y, unsigned w, unsigned h,
                           unsigned iteration, unsigned cpu,
-                          task_type_t task_type, int task_id)
+                          task_type_t task_type, int task_id,
+                          uint64_t *counters)
 {
-  trace_task_t *t = malloc (sizeof (trace_task_t));
-
-  t->start_time = shift (start_time);
-  t->end_time   = shift (end_time);
-  t->x          = x;
-  t->y          = y;
-  t->w          = w;
-  t->h          = h;
-  t->iteration  = iteration;
-  t->task_type  = task_type;
-  t->task_id    = task_id;
-
-  list_add_tail (&t->cpu_chain, tr->per_cpu + cpu);
-
-  if (current_it->first_cpu_task[cpu] == NULL)
-    current_it->first_cpu_task[cpu] = t;
+  trace_cpu_t *c = tr->per_cpu + cpu;
+  unsigned i;
+
+  if (c->nb_tasks == c->capacity)
+    grow_cpu (tr, c);
+
+  i                = c->nb_tasks++;
+  c->start_time[i] = shift (start_time);
+  c->end_time[i]   = shift (end_time);
+  c->x[i]          = x;
+  c->y[i]          = y;
+  c->w[i]          = w;
+  c->h[i]          = h;
+  c->iteration[i]  = iteration;
+  c->task_type[i]  = task_type;
+  c->task_id[i]    = task_id;
+
+  if (c->counters != NULL) {
+    if (counters != NULL)
+      memcpy (c->counters + i * NB_COUNTERS, counters,
+              NB_COUNTERS * sizeof (uint64_t));
+    else
+      memset (c->counters + i * NB_COUNTERS, 0,
+              NB_COUNTERS * sizeof (uint64_t));
+  }
 }
 
 static void trace_data_display_all (trace_t *tr)
@@ -118,25 +168,22 @@ static void trace_data_display_all (trace_t *tr)
     printf ("*** Iteration %d ***\n", it + 1);
 
     for (int c = 0; c < tr->nb_cores; c++) {
+      trace_cpu_t *cpu = tr->per_cpu + c;
+
       printf ("On CPU %d :\n", c);
 
-      // We get a pointer on the first task of the current iteration executed by
-      // CPU 'c'
-      trace_task_t *first = tr->iteration[it].first_cpu_task[c];
-
-      if (first != NULL)
-        // We follow the list of tasks, starting from this first task
-        list_for_each_entry_from (trace_task_t, t, tr->per_cpu + c, first,
-                                  cpu_chain)
-        {
-          // We stop if we encounter a task belonging to a greater iteration
-          if (t->iteration > it + 1)
-            break;
-
-          printf ("Task: time [%lu-%lu], tile [%d, %d, %d, %d], iteration %d\n",
-                  task_start_time (tr, t), task_end_time (tr, t), t->x, t->y,
-                  t->w, t->h, t->iteration);
-        }
+      // We start from the first task of the current iteration executed by CPU
+      // 'c'
+      for (unsigned i = tr->iteration[it].first_cpu_task[c]; i < cpu->nb_tasks;
+           i++) {
+        // We stop if we encounter a task belonging to a greater iteration
+        if (cpu->iteration[i] > it)
+          break;
+
+        printf ("Task: time [%lu-%lu], tile [%d, %d, %d, %d], iteration %d\n",
+                task_start_time (tr, cpu, i), task_end_time (tr, cpu, i),
+                cpu->x[i], cpu->y[i], cpu->w[i], cpu->h[i], cpu->iteration[i]);
+      }
     }
   }
 }
@@ -147,67 +194,171 @@ void trace_data_start_iteration (trace_t *tr, long start_time)
 
   // printf ("Iteration %d : start %lu -> ", tr->nb_iterations, start_time);
 #ifdef REMOVE_OVERHEAD
-  overhead += shift (start_time) - end_last_iteration - fixed_gap;
+  overhead[tr->num] += shift (start_time) - end_last_iteration[tr->num] -
+                       fixed_gap[tr->num];
 #endif
 
-  current_it                 = malloc (sizeof (trace_iteration_t));
-  current_it->correction     = 0;
-  current_it->gap            = 0;
-  current_it->start_time     = shift (start_time);
-  current_it->first_cpu_task = malloc (tr->nb_cores * sizeof (trace_task_t *));
-  for (int c = 0; c < tr->nb_cores; c++)
-    current_it->first_cpu_task[c] = NULL;
+  unsigned *capacity = iterations_capacity + tr->num;
 
-  list_add_tail (&current_it->chain, &tmp_list);
+  if (tr->nb_iterations > *capacity) {
+    *capacity     = *capacity ? *capacity * 2 : 64;
+    tr->iteration = realloc (tr->iteration,
+                             *capacity * sizeof (trace_iteration_t));
+    if (tr->iteration == NULL)
+      exit_with_error ("Cannot allocate trace data");
+  }
 
-  // printf ("%lu\n", current_it->start_time);
+  trace_iteration_t *it = tr->iteration + tr->nb_iterations - 1;
+
+  current_it[tr->num] = it;
+  it->correction      = 0;
+  it->gap             = 0;
+  it->start_time      = shift (start_time);
+  it->end_time        = it->start_time;
+  it->nb_tiles        = 0;
+  it->nb_sampled      = 0;
+  it->busy_time       = 0;
+  memset (it->counters, 0, sizeof (it->counters));
+
+  // Tasks are appended in time order: the first task of the iteration will be
+  // the next one of each CPU. If a CPU executes no task during this iteration,
+  // first_cpu_task points to a task belonging to a later iteration (or past
+  // the last task).
+  it->first_cpu_task = malloc (tr->nb_cores * sizeof (unsigned));
+  for (int c = 0; c < tr->nb_cores; c++)
+    it->first_cpu_task[c] = tr->per_cpu[c].nb_tasks;
+
+  // printf ("%lu\n", it->start_time);
 }
 
 void trace_data_end_iteration (trace_t *tr, long end_time)
 {
-  current_it->end_time = shift (end_time);
+  current_it[tr->num]->end_time = shift (end_time);
 #ifdef REMOVE_OVERHEAD
-  end_last_iteration = current_it->end_time;
+  end_last_iteration[tr->num] = current_it[tr->num]->end_time;
   if (tr->nb_iterations == 1) {
     // gap = 10% of first iteration
-    // fixed_gap = (current_it->end_time - current_it->start_time) * 10 / 100;
-    fixed_gap = 200;
+    // fixed_gap = (end_time - start_time) * 10 / 100;
+    fixed_gap[tr->num] = 200;
   }
 #endif
   // printf ("Iteration %d : end %lu -> %lu\n", tr->nb_iterations, end_time,
   // end_last_iteration);
 }
 
+void trace_data_iteration_counters (trace_t *tr, uint64_t *counters)
+{
+  for (int c = 0; c < NB_COUNTERS; c++) {
+    current_it[tr->num]->counters[c] = counters[c];
+    tr->counters[c] += counters[c];
+  }
+}
+
+void trace_data_iteration_summary (trace_t *tr, unsigned long nb_tiles,
+                                   unsigned long nb_sampled, long busy_time)
+{
+  current_it[tr->num]->nb_tiles   = nb_tiles;
+  current_it[tr->num]->nb_sampled = nb_sampled;
+  current_it[tr->num]->busy_time  = busy_time;
+}
+
 void trace_data_no_more_data (trace_t *tr)
 {
-  unsigned cpt  = 0;
-  tr->iteration = malloc (tr->nb_iterations * sizeof (trace_iteration_t));
-
-  // Now we know the number of iterations: we copy the list' elements
-  // into an array, and we delete the list
-  list_for_each_entry_safe (trace_iteration_t, pos, &tmp_list, chain)
-  {
-    list_del (&pos->chain);
-    tr->iteration[cpt] = *pos;
-    free (pos);
-    cpt++;
+  // Release unused space
+  if (tr->nb_iterations > 0)
+    tr->iteration =
+        realloc (tr->iteration, tr->nb_iterations * sizeof (trace_iteration_t));
+}
+
+#define drop_column(c, field, n)                                               \
+  memmove ((c)->field, (c)->field + (n),                                       \
+           ((c)->nb_tasks - (n)) * sizeof (*(c)->field))
+
+void trace_data_drop_iterations (trace_t *tr, unsigned n)
+{
+  if (n == 0)
+    return;
+  if (n > tr->nb_iterations)
+    n = tr->nb_iterations;
+
+  for (int c = 0; c < tr->nb_cores; c++) {
+    trace_cpu_t *cpu = tr->per_cpu + c;
+    const unsigned k = iteration_tasks_end (tr, c, n - 1);
+
+    drop_column (cpu, start_time, k);
+    drop_column (cpu, end_time, k);
+    drop_column (cpu, x, k);
+    drop_column (cpu, y, k);
+    drop_column (cpu, w, k);
+    drop_column (cpu, h, k);
+    drop_column (cpu, task_type, k);
+    drop_column (cpu, task_id, k);
+    drop_column (cpu, iteration, k);
+    if (cpu->counters != NULL)
+      memmove (cpu->counters, cpu->counters + k * NB_COUNTERS,
+               (cpu->nb_tasks - k) * NB_COUNTERS * sizeof (uint64_t));
+    cpu->nb_tasks -= k;
+
+    for (unsigned i = 0; i < cpu->nb_tasks; i++)
+      cpu->iteration[i] -= n;
+
+    for (unsigned it = n; it < tr->nb_iterations; it++)
+      tr->iteration[it].first_cpu_task[c] -= k;
   }
 
-  // We now finalize 'first_cpu_task' arrays so that
-  // iteration[i].first_cpu_task[c] points on the first task the starting time
-  // of which is greater or equal to start time of iteration i. In other words,
-  // iteration[i].first_cpu_task[c] can point on a task belonging to an
-  // iteration j > i.
-  if (tr->nb_iterations > 1) {
-    for (int i = tr->nb_iterations - 2; i >= 0; i--) {
-      for (int c = 0; c < tr->nb_cores; c++)
-        if (tr->iteration[i].first_cpu_task[c] == NULL)
-          tr->iteration[i].first_cpu_task[c] =
-              tr->iteration[i + 1].first_cpu_task[c];
-    }
+  for (unsigned it = 0; it < n; it++)
+    free (tr->iteration[it].first_cpu_task);
+
+  // The iteration being loaded moves along with the others
+  if (current_it[tr->num] != NULL)
+    current_it[tr->num] = (current_it[tr->num] >= tr->iteration + n)
+                              ? current_it[tr->num] - n
+                              : NULL;
+
+  memmove (tr->iteration, tr->iteration + n,
+           (tr->nb_iterations - n) * sizeof (trace_iteration_t));
+  tr->nb_iterations -= n;
+  tr->first_iteration += n;
+}
+
+void trace_data_forget_tasks (trace_t *tr)
+{
+  for (int c = 0; c < tr->nb_cores; c++) {
+    trace_cpu_t *cpu = tr->per_cpu + c;
+
+    free (cpu->start_time);
+    free (cpu->end_time);
+    free (cpu->x);
+    free (cpu->y);
+    free (cpu->w);
+    free (cpu->h);
+    free (cpu->task_type);
+    free (cpu->task_id);
+    free (cpu->iteration);
+    free (cpu->counters);
+    memset (cpu, 0, sizeof (trace_cpu_t));
   }
 }
 
+void trace_data_reload_start (trace_t *tr, unsigned it, long start_time)
+{
+#ifdef REMOVE_OVERHEAD
+  // Tasks are shifted as they were when the iteration was first loaded
+  overhead[tr->num] = start_time - tr->iteration[it].start_time;
+#endif
+
+  for (int c = 0; c < tr->nb_cores; c++)
+    tr->iteration[it].first_cpu_task[c] = tr->per_cpu[c].nb_tasks;
+}
+
+void trace_data_reload_end (trace_t *tr, unsigned it)
+{
+  // The range of tasks of iteration it ends where the next one starts
+  if (it + 1 < tr->nb_iterations)
+    for (int c = 0; c < tr->nb_cores; c++)
+      tr->iteration[it + 1].first_cpu_task[c] = tr->per_cpu[c].nb_tasks;
+}
+
 void trace_data_finalize (void)
 {
   // TODO: Free all memory!
@@ -273,32 +424,30 @@ void trace_data_sync_iterations (void)
   }
 
   long cur_correction[MAX_TRACES] = {0};
-  unsigned min_it = min (trace[0].nb_iterations, trace[1].nb_iterations);
-
-  for (int it = 0; it < min_it; it++) {
-    // We apply correctiun accumulated in previous iterations
-    trace[0].iteration[it].correction = cur_correction[0];
-    trace[1].iteration[it].correction = cur_correction[1];
-
-    // We compare durations
-    long d0 =
-        trace[0].iteration[it].end_time - trace[0].iteration[it].start_time;
-    long d1 =
-        trace[1].iteration[it].end_time - trace[1].iteration[it].start_time;
-    if (d0 < d1) {
-      trace[0].iteration[it].gap = d1 - d0;
-      // We update accumulated adjustment
-      cur_correction[0] += trace[0].iteration[it].gap;
-    } else {
-      trace[1].iteration[it].gap = d0 - d1;
-      // We update accumulated adjustment
-      cur_correction[1] += trace[1].iteration[it].gap;
-    }
+  unsigned max_it                 = 0;
+
+  for (int t = 0; t < nb_traces; t++)
+    max_it = max (max_it, trace[t].nb_iterations);
+
+  for (int it = 0; it < max_it; it++) {
+    long slowest = 0;
+
+    // We look for the longest duration among traces having this iteration
+    for (int t = 0; t < nb_traces; t++)
+      if (it < trace[t].nb_iterations)
+        slowest = max (slowest, trace[t].iteration[it].end_time -
+                                    trace[t].iteration[it].start_time);
+
+    for (int t = 0; t < nb_traces; t++)
+      if (it < trace[t].nb_iterations) {
+        trace_iteration_t *iter = trace[t].iteration + it;
+
+        // We apply correction accumulated in previous iterations
+        iter->correction = cur_correction[t];
+        // Faster traces are stretched to match the slowest one
+        iter->gap = slowest - (iter->end_time - iter->start_time);
+        // We update accumulated adjustment
+        cur_correction[t] += iter->gap;
+      }
   }
-  // We check if one trace has more iterations
-  int remaining = (trace[0].nb_iterations > trace[1].nb_iterations) ? 0 : 1;
-
-  for (int it = min_it; it < trace[remaining].nb_iterations; it++) {
-    trace[remaining].iteration[it].correction = cur_correction[remaining];
-  }
-}
\ No newline at end of file
+}
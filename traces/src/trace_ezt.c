@@ -0,0 +1,157 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "error.h"
+#include "trace_ezt.h"
+
+int ezt_file_is_native (char *file)
+{
+  char magic[4];
+  int fd = open (file, O_RDONLY);
+  int r  = 0;
+
+  if (fd < 0)
+    return 0;
+
+  if (read (fd, magic, sizeof (magic)) == sizeof (magic))
+    r = !memcmp (magic, EZT_MAGIC, sizeof (magic));
+
+  close (fd);
+  return r;
+}
+
+void ezt_file_open (ezt_file_t *f, char *file)
+{
+  struct stat st;
+  uint64_t end;
+  unsigned nb_lanes, stride;
+  uint64_t nb_strings;
+  int fd = open (file, O_RDONLY);
+
+  if (fd < 0)
+    exit_with_error ("Cannot open \"%s\" trace file (%s)", file,
+                     strerror (errno));
+
+  if (fstat (fd, &st) < 0)
+    exit_with_error ("Cannot stat \"%s\" (%s)", file, strerror (errno));
+
+  if (st.st_size < sizeof (ezt_header_t))
+    exit_with_error ("\"%s\" is too small to be a trace file", file);
+
+  f->size = st.st_size;
+  f->base = mmap (NULL, f->size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (f->base == MAP_FAILED)
+    exit_with_error ("Cannot map \"%s\" (%s)", file, strerror (errno));
+
+  close (fd);
+
+  f->header = f->base;
+  if (memcmp (f->header->magic, EZT_MAGIC, 4) ||
+      f->header->version != EZT_VERSION)
+    exit_with_error ("\"%s\" is not a version %d trace file", file,
+                     EZT_VERSION);
+
+  nb_lanes = f->header->nb_cores + f->header->nb_gpu;
+  stride   = f->header->nb_iterations + 1;
+
+  // Sizes are computed on 64 bits so that a corrupted header cannot wrap
+  end = sizeof (ezt_header_t) + EZT_PAD8 ((uint64_t)f->header->strings_size) +
+        (uint64_t)f->header->nb_iterations * sizeof (ezt_iteration_t) +
+        (uint64_t)nb_lanes * sizeof (ezt_lane_t) +
+        (uint64_t)nb_lanes * ((uint64_t)f->header->nb_iterations + 1) *
+            sizeof (ezt_index_t);
+  if (end > f->size)
+    exit_with_error ("\"%s\" is truncated", file);
+
+  f->strings    = (const char *)(f->header + 1);
+  f->iterations = (const ezt_iteration_t *)(f->strings +
+                                            EZT_PAD8 (f->header->strings_size));
+  f->lanes      = (const ezt_lane_t *)(f->iterations +
+                                       f->header->nb_iterations);
+  f->index      = (const ezt_index_t *)(f->lanes + nb_lanes);
+
+  // The label and each task id must be terminated
+  nb_strings = 0;
+  for (uint32_t i = 0; i < f->header->strings_size; i++)
+    nb_strings += (f->strings[i] == '\0');
+  if (nb_strings < f->header->task_ids_count + 1)
+    exit_with_error ("\"%s\": bad string table", file);
+
+  // Tasks are decoded without further checks: streams must lie inside the
+  // file and iterations inside their streams
+  for (unsigned l = 0; l < nb_lanes; l++) {
+    const ezt_lane_t *lane = f->lanes + l;
+    const ezt_index_t *idx = f->index + (size_t)l * stride;
+
+    for (int s = 0; s < EZT_NB_STREAMS; s++)
+      if (lane->offset[s] > f->size ||
+          lane->size[s] > f->size - lane->offset[s])
+        exit_with_error ("\"%s\": stream %d of lane %u is out of bounds", file,
+                         s, l);
+
+    for (unsigned it = 0; it < stride; it++) {
+      if ((it > 0 && idx[it].first_task < idx[it - 1].first_task) ||
+          idx[it].first_task > lane->nb_tasks)
+        exit_with_error ("\"%s\": bad task index for lane %u, iteration %u",
+                         file, l, it);
+
+      for (int s = 0; s < EZT_NB_STREAMS; s++)
+        if (idx[it].offset[s] > lane->size[s])
+          exit_with_error ("\"%s\": stream %d of lane %u, iteration %u is out "
+                           "of bounds",
+                           file, s, l, it);
+    }
+  }
+}
+
+void ezt_file_close (ezt_file_t *f)
+{
+  munmap (f->base, f->size);
+  f->base = NULL;
+}
+
+void ezt_cursor_init (ezt_file_t *f, ezt_cursor_t *c, unsigned lane,
+                      unsigned it)
+{
+  const unsigned stride  = f->header->nb_iterations + 1;
+  const ezt_index_t *cur = f->index + lane * stride + it;
+  const ezt_lane_t *l    = f->lanes + lane;
+
+  for (int s = 0; s < EZT_NB_STREAMS; s++)
+    c->p[s] = (const uint8_t *)f->base + l->offset[s] + cur->offset[s];
+
+  c->remaining    = cur[1].first_task - cur[0].first_task;
+  c->prev         = f->iterations[it].start_time;
+  c->has_counters = (f->header->counters_mask != 0);
+}
+
+int ezt_cursor_next (ezt_cursor_t *c, ezt_task_t *t)
+{
+  const uint8_t **time = c->p + EZT_STREAM_TIME;
+
+  if (c->remaining == 0)
+    return 0;
+
+  t->start_time = c->prev + ezt_unzigzag (ezt_get_varint (time));
+  t->end_time   = t->start_time + ezt_get_varint (time);
+  c->prev       = t->end_time;
+
+  t->x = ezt_get_varint (c->p + EZT_STREAM_TILE);
+  t->y = ezt_get_varint (c->p + EZT_STREAM_TILE);
+  t->w = ezt_get_varint (c->p + EZT_STREAM_TILE);
+  t->h = ezt_get_varint (c->p + EZT_STREAM_TILE);
+
+  t->task = ezt_get_varint (c->p + EZT_STREAM_TASK);
+
+  for (int k = 0; k < NB_COUNTERS; k++)
+    t->counters[k] =
+        c->has_counters ? ezt_get_varint (c->p + EZT_STREAM_COUNTERS) : 0;
+
+  c->remaining--;
+  return 1;
+}
@@ -3,7 +3,9 @@
 #include <fxt-tools.h>
 #include <fxt.h>
 #include <getopt.h>
+#include <inttypes.h>
 #include <libgen.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -13,25 +15,146 @@
 #include "error.h"
 #include "trace_common.h"
 #include "trace_data.h"
+#include "trace_ezt.h"
 #include "trace_file.h"
 
-static long *last_start_times = NULL;
-static unsigned current_iteration;
+unsigned trace_file_quiet = 0;
 
-void trace_file_load (char *file)
+// We do not know whether FxT can parse several files concurrently
+static pthread_mutex_t fxt_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Native traces stay mapped: only iteration metadata is loaded when the file
+// is opened, tasks are decoded on demand by trace_file_fetch_iterations.
+// Tasks of iterations [loaded_first, loaded_end) are in memory.
+static ezt_file_t ezt_file[MAX_TRACES];
+static unsigned loaded_first[MAX_TRACES] = {0};
+static unsigned loaded_end[MAX_TRACES]   = {0};
+
+static void trace_file_load_ezt (char *file, unsigned num)
+{
+  trace_t *tr   = &trace[num];
+  ezt_file_t *f = ezt_file + num;
+  const ezt_header_t *h;
+  const char *str;
+
+  ezt_file_open (f, file);
+  h = f->header;
+
+  trace_data_init (tr, num);
+
+  if (h->nb_gpu & 1) // number of GPU lanes must be even
+    exit_with_error ("Bad trace header: #GPU (= %d) expected to be even",
+                     h->nb_gpu);
+
+  trace_data_set_nb_threads (tr, h->nb_cores, h->nb_gpu);
+  trace_data_set_dim (tr, h->dim);
+  trace_data_set_first_iteration (tr, h->first_iteration);
+  if (h->counters_mask)
+    trace_data_set_counters (tr, h->counters_mask);
+
+  str = f->strings;
+  if (*str != '\0')
+    trace_data_set_label (tr, (char *)str);
+  str += strlen (str) + 1;
+
+  trace_data_alloc_task_ids (tr, h->task_ids_count);
+  for (int i = 0; i < h->task_ids_count; i++) {
+    trace_data_add_taskid (tr, (char *)str);
+    str += strlen (str) + 1;
+  }
+
+  for (unsigned it = 0; it < h->nb_iterations; it++) {
+    trace_data_start_iteration (tr, f->iterations[it].start_time);
+
+    if (h->counters_mask)
+      trace_data_iteration_counters (tr,
+                                     (uint64_t *)f->iterations[it].counters);
+
+    trace_data_iteration_summary (tr, f->iterations[it].nb_tiles,
+                                  f->iterations[it].nb_sampled,
+                                  f->iterations[it].busy_time);
+
+    trace_data_end_iteration (tr, f->iterations[it].end_time);
+  }
+
+  loaded_first[num] = loaded_end[num] = 0;
+}
+
+// Replaces the tasks in memory by those of iterations [first, end)
+static void decode_ezt_tasks (trace_t *tr, unsigned first, unsigned end)
 {
+  ezt_file_t *f         = ezt_file + tr->num;
+  const ezt_header_t *h = f->header;
+
+  trace_data_forget_tasks (tr);
+
+  for (unsigned it = first; it < end; it++) {
+    trace_data_reload_start (tr, it, f->iterations[it].start_time);
+
+    for (unsigned lane = 0; lane < h->nb_cores + h->nb_gpu; lane++) {
+      ezt_cursor_t c;
+      ezt_task_t t;
+
+      ezt_cursor_init (f, &c, lane, it);
+      while (ezt_cursor_next (&c, &t))
+        trace_data_add_task (tr, t.start_time, t.end_time, t.x, t.y, t.w, t.h,
+                             it, lane, TASK_EXTRACT_TTYPE (t.task),
+                             TASK_EXTRACT_TID (t.task),
+                             h->counters_mask ? t.counters : NULL);
+    }
+
+    trace_data_reload_end (tr, it);
+  }
+
+  loaded_first[tr->num] = first;
+  loaded_end[tr->num]   = end;
+}
+
+void trace_file_fetch_iterations (trace_t *tr, unsigned first, unsigned last,
+                                  unsigned margin)
+{
+  const unsigned num = tr->num;
+
+  if (ezt_file[num].base == NULL || tr->nb_iterations == 0) // all in memory
+    return;
+
+  if (last >= tr->nb_iterations)
+    last = tr->nb_iterations - 1;
+  if (first > last)
+    return;
+
+  if (first >= loaded_first[num] && last < loaded_end[num])
+    return;
+
+  first = (first > margin) ? first - margin : 0;
+  last  = (tr->nb_iterations - 1 - last > margin) ? last + margin
+                                                  : tr->nb_iterations - 1;
+
+  decode_ezt_tasks (tr, first, last + 1);
+}
+
+static void trace_file_load_fxt (char *file, unsigned num)
+{
+  trace_t *tr                = &trace[num];
+  long *last_start_times     = NULL;
+  unsigned current_iteration = 0;
   fxt_t fxt;
   fxt_blockev_t evs;
   struct fxt_ev_native ev;
   int ret;
 
+  // TRACE_TILE_COUNTERS events come before the TRACE_END_TILE event of the
+  // same lane
+  uint64_t (*pending_counters)[NB_COUNTERS] = NULL;
+  char *has_pending_counters                = NULL;
+
+  pthread_mutex_lock (&fxt_lock);
+
   if (!(fxt = fxt_open (file)))
     exit_with_error ("Cannot open \"%s\" trace file (%s)", file,
                      strerror (errno));
 
-  current_iteration = 0;
-
-  trace_data_init (&trace[nb_traces], nb_traces);
+  trace_data_init (tr, num);
 
   evs = fxt_blockev_enter (fxt);
 
@@ -42,11 +165,11 @@ void trace_file_load (char *file)
 
     switch (ev.code) {
     case TRACE_BEGIN_ITER:
-      trace_data_start_iteration (&trace[nb_traces], ev.param[0]);
+      trace_data_start_iteration (tr, ev.param[0]);
       break;
 
     case TRACE_END_ITER:
-      trace_data_end_iteration (&trace[nb_traces], ev.param[0]);
+      trace_data_end_iteration (tr, ev.param[0]);
       current_iteration++;
       break;
 
@@ -57,10 +180,12 @@ void trace_file_load (char *file)
         exit_with_error ("Bad trace header: #GPU (= %d) expected to be even",
                          ng);
 
-      last_start_times = malloc ((nc + ng) * sizeof (long));
+      last_start_times     = malloc ((nc + ng) * sizeof (long));
+      pending_counters     = malloc ((nc + ng) * sizeof (*pending_counters));
+      has_pending_counters = calloc (nc + ng, sizeof (char));
       for (int c = 0; c < nc + ng; c++)
         last_start_times[c] = 0;
-      trace_data_set_nb_threads (&trace[nb_traces], nc, ng);
+      trace_data_set_nb_threads (tr, nc, ng);
       break;
     }
 
@@ -70,29 +195,57 @@ void trace_file_load (char *file)
 
     case TRACE_END_TILE:
       trace_data_add_task (
-          &trace[nb_traces], last_start_times[cpu], ev.param[0], ev.param[2],
+          tr, last_start_times[cpu], ev.param[0], ev.param[2],
           ev.param[3], ev.param[4], ev.param[5], current_iteration, cpu,
-          TASK_EXTRACT_TTYPE (ev.param[6]), TASK_EXTRACT_TID (ev.param[6]));
+          TASK_EXTRACT_TTYPE (ev.param[6]), TASK_EXTRACT_TID (ev.param[6]),
+          has_pending_counters[cpu] ? pending_counters[cpu] : NULL);
+      has_pending_counters[cpu] = 0;
+      break;
+
+    case TRACE_COUNTERS:
+      trace_data_set_counters (tr, ev.param[0]);
+      break;
+
+    case TRACE_TILE_COUNTERS: {
+      unsigned lane = ev.param[0];
+
+      for (int c = 0; c < NB_COUNTERS; c++)
+        pending_counters[lane][c] = ev.param[c + 1];
+      has_pending_counters[lane] = 1;
+      break;
+    }
+
+    case TRACE_ITER_COUNTERS: {
+      uint64_t counters[NB_COUNTERS];
+
+      for (int c = 0; c < NB_COUNTERS; c++)
+        counters[c] = ev.param[c];
+      trace_data_iteration_counters (tr, counters);
+      break;
+    }
+
+    case TRACE_ITER_SUMMARY:
+      trace_data_iteration_summary (tr, ev.param[0], ev.param[1], ev.param[2]);
       break;
 
     case TRACE_DIM:
-      trace_data_set_dim (&trace[nb_traces], ev.param[0]);
+      trace_data_set_dim (tr, ev.param[0]);
       break;
 
     case TRACE_FIRST_ITER:
-      trace_data_set_first_iteration (&trace[nb_traces], ev.param[0]);
+      trace_data_set_first_iteration (tr, ev.param[0]);
       break;
 
     case TRACE_LABEL:
-      trace_data_set_label (&trace[nb_traces], (char *)ev.raw);
+      trace_data_set_label (tr, (char *)ev.raw);
       break;
 
     case TRACE_TASKID_COUNT:
-      trace_data_alloc_task_ids (&trace[nb_traces], ev.param[0]);
+      trace_data_alloc_task_ids (tr, ev.param[0]);
       break;
 
     case TRACE_TASKID:
-      trace_data_add_taskid (&trace[nb_traces], (char *)ev.raw);
+      trace_data_add_taskid (tr, (char *)ev.raw);
       break;
 
     default:
@@ -107,24 +260,107 @@ void trace_file_load (char *file)
   // fxt_close (fxt);
 
   free (last_start_times);
-  last_start_times = NULL;
+  free (pending_counters);
+  free (has_pending_counters);
+
+  pthread_mutex_unlock (&fxt_lock);
+}
+
+static void load (char *file, unsigned num)
+{
+  if (ezt_file_is_native (file))
+    trace_file_load_ezt (file, num);
+  else
+    trace_file_load_fxt (file, num);
 
   // Set a default label
-  if (trace[nb_traces].label == NULL) {
+  if (trace[num].label == NULL) {
     char *name    = basename (file);
     char *lastdot = strrchr (name, '.');
     if (lastdot != NULL)
       *lastdot = '\0';
 
-    trace_data_set_label (&trace[nb_traces], name);
+    trace_data_set_label (&trace[num], name);
   }
 
-  trace_data_no_more_data (&trace[nb_traces]);
+  trace_data_no_more_data (&trace[num]);
+}
+
+static void report (char *file, unsigned num)
+{
+  trace_t *tr = &trace[num];
+
+  if (trace_file_quiet)
+    return;
 
   printf (
-      "Trace #%d \"%s\" successfully opened: %d iterations on %d CPUs (%s)\n",
-      nb_traces, trace[nb_traces].label, trace[nb_traces].nb_iterations,
-      trace[nb_traces].nb_cores, file);
+      "Trace #%d \"%s\" successfully opened: %d iterations on %d CPUs (%s)\n",
+      num, tr->label, tr->nb_iterations, tr->nb_cores, file);
+
+  if (tr->counters_mask) {
+    printf ("Hardware counters:");
+    for (int c = 0; c < NB_COUNTERS; c++)
+      if (tr->counters_mask & (1U << c))
+        printf (" %s %" PRIu64, counter_names[c], tr->counters[c]);
+    if ((tr->counters_mask & (1U << COUNTER_CYCLES)) &&
+        (tr->counters_mask & (1U << COUNTER_INSTRUCTIONS)) &&
+        tr->counters[COUNTER_CYCLES])
+      printf (" (IPC %.2f)", (double)tr->counters[COUNTER_INSTRUCTIONS] /
+                                 tr->counters[COUNTER_CYCLES]);
+    printf ("\n");
+  }
+}
+
+void trace_file_load (char *file)
+{
+  load (file, nb_traces);
+  report (file, nb_traces);
 
   nb_traces++;
 }
+
+typedef struct
+{
+  char *file;
+  unsigned num;
+} load_job_t;
+
+static void *load_thread (void *arg)
+{
+  load_job_t *job = arg;
+
+  load (job->file, job->num);
+
+  return NULL;
+}
+
+void trace_file_load_all (char *files[], unsigned n)
+{
+  pthread_t tid[MAX_TRACES];
+  load_job_t job[MAX_TRACES];
+
+  if (nb_traces + n > MAX_TRACES)
+    exit_with_error ("Too many trace files specified (max %d)", MAX_TRACES);
+
+  if (n == 1) {
+    trace_file_load (files[0]);
+    return;
+  }
+
+  // Each trace is loaded by its own thread
+  for (unsigned t = 0; t < n; t++) {
+    job[t].file = files[t];
+    job[t].num  = nb_traces + t;
+    if (pthread_create (tid + t, NULL, load_thread, job + t))
+      exit_with_error ("Cannot create loading thread");
+  }
+
+  for (unsigned t = 0; t < n; t++)
+    pthread_join (tid[t], NULL);
+
+  // Reports are printed in order
+  for (unsigned t = 0; t < n; t++)
+    report (files[t], nb_traces + t);
+
+  nb_traces += n;
+}
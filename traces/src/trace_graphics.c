@@ -9,11 +9,13 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/types.h>
 #include <unistd.h>
 
 #include "error.h"
 #include "trace_common.h"
+#include "trace_file.h"
 #include "trace_graphics.h"
 
 #define min(a, b) ((a) < (b) ? (a) : (b))
@@ -53,7 +55,7 @@ static SDL_Texture *black_square       = NULL;
 static SDL_Texture *white_square       = NULL;
 
 #ifdef PRELOAD_THUMBNAILS
-static SDL_Texture **thumb_tex[MAX_TRACES] = {NULL, NULL};
+static SDL_Texture **thumb_tex[MAX_TRACES] = {NULL};
 #endif
 
 static int TASK_HEIGHT   = MAX_TASK_HEIGHT;
@@ -136,6 +138,24 @@ static inline unsigned layout_get_min_width (void)
   return WINDOW_MIN_WIDTH;
 }
 
+// Number of CPU rows of all traces
+static unsigned layout_get_total_cores (void)
+{
+  unsigned total = 0;
+
+  for (int t = 0; t < nb_traces; t++)
+    total += trace[t].nb_cores;
+
+  return total;
+}
+
+// Mosaics are stacked on the right side: they have to shrink when more than
+// two traces are displayed
+static unsigned layout_get_min_preview_dim (void)
+{
+  return nb_traces <= 2 ? MIN_PREVIEW_DIM : 2 * MIN_PREVIEW_DIM / nb_traces;
+}
+
 static unsigned layout_get_min_height (void)
 {
   unsigned need_left, need_right, gantt_h;
@@ -145,11 +165,10 @@ static unsigned layout_get_min_height (void)
     gantt_h    = trace[0].nb_cores * (MIN_TASK_HEIGHT + 2 * Y_MARGIN + 2);
     need_left  = TOP_MARGIN + gantt_h + BOTTOM_MARGIN;
   } else {
-    need_right =
-        TOP_MARGIN + 2 * MIN_PREVIEW_DIM + INTERTRACE_MARGIN + BOTTOM_MARGIN;
-    gantt_h = (trace[0].nb_cores + trace[1].nb_cores) *
-                  (MIN_TASK_HEIGHT + 2 * Y_MARGIN + 2) +
-              INTERTRACE_MARGIN;
+    need_right = TOP_MARGIN + nb_traces * layout_get_min_preview_dim () +
+                 (nb_traces - 1) * INTERTRACE_MARGIN + BOTTOM_MARGIN;
+    gantt_h = layout_get_total_cores () * (MIN_TASK_HEIGHT + 2 * Y_MARGIN + 2) +
+              (nb_traces - 1) * INTERTRACE_MARGIN;
     need_left = TOP_MARGIN + gantt_h + BOTTOM_MARGIN;
   }
   return max (need_left, need_right);
@@ -164,11 +183,10 @@ static unsigned layout_get_max_height (void)
     gantt_h    = trace[0].nb_cores * (MAX_TASK_HEIGHT + 2 * Y_MARGIN + 2);
     need_left  = TOP_MARGIN + gantt_h + BOTTOM_MARGIN;
   } else {
-    need_right =
-        TOP_MARGIN + 2 * MAX_PREVIEW_DIM + INTERTRACE_MARGIN + BOTTOM_MARGIN;
-    gantt_h = (trace[0].nb_cores + trace[1].nb_cores) *
-                  (MAX_TASK_HEIGHT + 2 * Y_MARGIN + 2) +
-              INTERTRACE_MARGIN;
+    need_right = TOP_MARGIN + nb_traces * MAX_PREVIEW_DIM +
+                 (nb_traces - 1) * INTERTRACE_MARGIN + BOTTOM_MARGIN;
+    gantt_h = layout_get_total_cores () * (MAX_TASK_HEIGHT + 2 * Y_MARGIN + 2) +
+              (nb_traces - 1) * INTERTRACE_MARGIN;
     need_left = TOP_MARGIN + gantt_h + BOTTOM_MARGIN;
   }
   return max (need_left, need_right);
@@ -225,58 +243,57 @@ static void layout_recompute (void)
     trace_display_info[0].mosaic.w = PREVIEW_DIM;
     trace_display_info[0].mosaic.h = PREVIEW_DIM;
   } else {
-    unsigned padding = 0;
+    const unsigned margins = (nb_traces - 1) * INTERTRACE_MARGIN;
+    unsigned padding       = 0;
+    unsigned gantt_y, mosaic_space;
 
     // Compute preview size
-    PREVIEW_DIM =
-        min (MAX_PREVIEW_DIM,
-             max (MIN_PREVIEW_DIM,
-                  min (WINDOW_WIDTH / 4, (WINDOW_HEIGHT - TOP_MARGIN -
-                                          BOTTOM_MARGIN - INTERTRACE_MARGIN) /
-                                             2)));
+    PREVIEW_DIM = min (
+        MAX_PREVIEW_DIM,
+        max (layout_get_min_preview_dim (),
+             min (WINDOW_WIDTH / 4,
+                  (WINDOW_HEIGHT - TOP_MARGIN - BOTTOM_MARGIN - margins) /
+                      nb_traces)));
 
     // See how much space we have for GANTT chart
-    unsigned space =
-        WINDOW_HEIGHT - TOP_MARGIN - BOTTOM_MARGIN - INTERTRACE_MARGIN;
-    space /= (trace[0].nb_cores + trace[1].nb_cores);
+    unsigned space = WINDOW_HEIGHT - TOP_MARGIN - BOTTOM_MARGIN - margins;
+    space /= layout_get_total_cores ();
     TASK_HEIGHT = space - 2 * Y_MARGIN - 2;
     if (TASK_HEIGHT < MIN_TASK_HEIGHT)
       exit_with_error ("Window height (%d) is not big enough to display so "
                        "many CPUS (%d)\n",
-                       WINDOW_HEIGHT, trace[0].nb_cores);
+                       WINDOW_HEIGHT, layout_get_total_cores ());
 
     if (TASK_HEIGHT > MAX_TASK_HEIGHT)
       TASK_HEIGHT = MAX_TASK_HEIGHT;
 
     // First try with max task height
-    GANTT_HEIGHT = (trace[0].nb_cores + trace[1].nb_cores) * CPU_ROW_HEIGHT +
-                   INTERTRACE_MARGIN;
-    need_left = TOP_MARGIN + GANTT_HEIGHT + BOTTOM_MARGIN;
+    GANTT_HEIGHT = layout_get_total_cores () * CPU_ROW_HEIGHT + margins;
+    need_left    = TOP_MARGIN + GANTT_HEIGHT + BOTTOM_MARGIN;
 
     if (WINDOW_HEIGHT > need_left)
       padding = WINDOW_HEIGHT - need_left;
 
-    trace_display_info[0].gantt.x = LEFT_MARGIN;
-    trace_display_info[0].gantt.y = TOP_MARGIN + padding / 2;
-    trace_display_info[0].gantt.w = GANTT_WIDTH;
-    trace_display_info[0].gantt.h = trace[0].nb_cores * CPU_ROW_HEIGHT;
-
-    trace_display_info[0].mosaic.x = LEFT_MARGIN + GANTT_WIDTH + TOP_MARGIN / 2;
-    trace_display_info[0].mosaic.y = TOP_MARGIN;
-    trace_display_info[0].mosaic.w = PREVIEW_DIM;
-    trace_display_info[0].mosaic.h = PREVIEW_DIM;
-
-    trace_display_info[1].gantt.x = LEFT_MARGIN;
-    trace_display_info[1].gantt.y = TOP_MARGIN + INTERTRACE_MARGIN +
-                                    trace_display_info[0].gantt.h + padding / 2;
-    trace_display_info[1].gantt.w = GANTT_WIDTH;
-    trace_display_info[1].gantt.h = trace[1].nb_cores * CPU_ROW_HEIGHT;
-
-    trace_display_info[1].mosaic.w = PREVIEW_DIM;
-    trace_display_info[1].mosaic.h = PREVIEW_DIM;
-    trace_display_info[1].mosaic.x = LEFT_MARGIN + GANTT_WIDTH + TOP_MARGIN / 2;
-    trace_display_info[1].mosaic.y =
-        WINDOW_HEIGHT - BOTTOM_MARGIN - trace_display_info[1].mosaic.h;
+    // The first mosaic is at the top, the last one at the bottom, and the
+    // others evenly spread in between
+    mosaic_space = WINDOW_HEIGHT - BOTTOM_MARGIN - PREVIEW_DIM - TOP_MARGIN;
+    gantt_y      = TOP_MARGIN + padding / 2;
+
+    for (int t = 0; t < nb_traces; t++) {
+      trace_display_info[t].gantt.x = LEFT_MARGIN;
+      trace_display_info[t].gantt.y = gantt_y;
+      trace_display_info[t].gantt.w = GANTT_WIDTH;
+      trace_display_info[t].gantt.h = trace[t].nb_cores * CPU_ROW_HEIGHT;
+
+      trace_display_info[t].mosaic.x =
+          LEFT_MARGIN + GANTT_WIDTH + TOP_MARGIN / 2;
+      trace_display_info[t].mosaic.y =
+          TOP_MARGIN + t * mosaic_space / (nb_traces - 1);
+      trace_display_info[t].mosaic.w = PREVIEW_DIM;
+      trace_display_info[t].mosaic.h = PREVIEW_DIM;
+
+      gantt_y += trace_display_info[t].gantt.h + INTERTRACE_MARGIN;
+    }
   }
 
   gantts_bounding_box.x = trace_display_info[0].gantt.x;
@@ -335,24 +352,34 @@ static inline int rects_do_intersect (const SDL_Rect *r1, const SDL_Rect *r2)
   return SDL_HasIntersection (r1, r2);
 }
 
-static inline void get_raw_rect (trace_task_t *t, SDL_Rect *dst)
+static inline void get_raw_rect (trace_cpu_t *c, unsigned i, SDL_Rect *dst)
 {
-  dst->x = t->x;
-  dst->y = t->y;
-  dst->w = t->w;
-  dst->h = t->h;
+  dst->x = c->x[i];
+  dst->y = c->y[i];
+  dst->w = c->w[i];
+  dst->h = c->h[i];
 }
 
-static int get_y_mouse_sibbling (void)
+// Returns the trace whose Gantt chart is under the mouse, or -1
+static int get_mouse_gantt (void)
 {
-  for (int t = 0; t < nb_traces; t++) {
-    if (point_in_rect (&mouse, &trace_display_info[t].gantt)) {
-      int dy = mouse.y - trace_display_info[t].gantt.y;
-      if (dy < trace_display_info[1 - t].gantt.h)
-        return trace_display_info[1 - t].gantt.y + dy;
-      else
-        return mouse.y;
-    }
+  for (int t = 0; t < nb_traces; t++)
+    if (point_inside_gantt (&mouse, t))
+      return t;
+
+  return -1;
+}
+
+// Returns the y coordinate of the row of trace 'sibling' matching the row
+// under the mouse
+static int get_y_mouse_sibbling (int sibling)
+{
+  int t = get_mouse_gantt ();
+
+  if (t != -1) {
+    int dy = mouse.y - trace_display_info[t].gantt.y;
+    if (dy < trace_display_info[sibling].gantt.h)
+      return trace_display_info[sibling].gantt.y + dy;
   }
   return mouse.y;
 }
@@ -377,36 +404,42 @@ static void preload_thumbnails (unsigned nb_iter)
 {
   if (use_thumbnails) {
     unsigned success = 0, expected = 0;
-    unsigned nb_dirs  = 0;
-    unsigned bound[2] = {nb_iter, nb_iter};
-    char *dir[2]      = {trace_dir[0], trace_dir[1]};
-
-    if (trace_dir[1] ||
-        trace[0].first_iteration != trace[nb_traces - 1].first_iteration) {
-      // Ok, we have to use two separate arrays to store textures,
-      // either because thumbnails are located in two separate folders
-      // or because we compare two traces starting from a different iteration
-      // number. (Note that in this latter case -- and if iteration ranges
-      // overlap -- we could probably try to load once and shift the indexes in
-      // the second array... I don't think it is relevant)
-
-      nb_dirs = 2;
-      if (!dir[1])
-        dir[1] = dir[0];
-      bound[0]     = trace[0].nb_iterations;
-      bound[1]     = trace[1].nb_iterations;
-      expected     = bound[0] + bound[1];
-      thumb_tex[0] = malloc (bound[0] * sizeof (SDL_Texture *));
-      thumb_tex[1] = malloc (bound[1] * sizeof (SDL_Texture *));
+    unsigned nb_dirs = 0;
+    unsigned bound[MAX_TRACES];
+    char *dir[MAX_TRACES];
+    int separate = 0;
+
+    for (int t = 1; t < nb_traces; t++)
+      if (trace_dir[t] || trace[0].first_iteration != trace[t].first_iteration)
+        separate = 1;
+
+    if (separate) {
+      // Ok, we have to use separate arrays to store textures, either because
+      // thumbnails are located in separate folders or because we compare
+      // traces starting from a different iteration number. (Note that in this
+      // latter case -- and if iteration ranges overlap -- we could probably
+      // try to load once and shift the indexes in the other arrays... I don't
+      // think it is relevant)
+
+      nb_dirs = nb_traces;
+      for (int t = 0; t < nb_traces; t++) {
+        dir[t]       = trace_dir[t] ?: trace_dir[0];
+        bound[t]     = trace[t].nb_iterations;
+        thumb_tex[t] = malloc (bound[t] * sizeof (SDL_Texture *));
+        expected += bound[t];
+      }
     } else {
       // We use a unique array to store thumbnails, either because we're
-      // displaying a single trace or because we compare two traces with one
-      // iteration range being a subset of the other (in this case, nb_iter is
-      // the maximum number of iterations).
+      // displaying a single trace or because we compare traces with
+      // iteration ranges being subsets of the widest one (in this case,
+      // nb_iter is the maximum number of iterations).
       nb_dirs      = 1;
+      dir[0]       = trace_dir[0];
+      bound[0]     = nb_iter;
       expected     = bound[0];
       thumb_tex[0] = malloc (nb_iter * sizeof (SDL_Texture *));
-      thumb_tex[1] = thumb_tex[0];
+      for (int t = 1; t < nb_traces; t++)
+        thumb_tex[t] = thumb_tex[0];
     }
 
     for (int d = 0; d < nb_dirs; d++)
@@ -753,21 +786,22 @@ static void create_misc_tex (void)
 
 // Display functions
 
-static inline int get_tile_rect (trace_t *tr, trace_task_t *t, SDL_Rect *dst)
+static inline int get_tile_rect (trace_t *tr, trace_cpu_t *c, unsigned i,
+                                 SDL_Rect *dst)
 {
-  if (t->w && t->h) {
-    dst->x = t->x * trace_display_info[tr->num].mosaic.w / tr->dimensions +
+  if (c->w[i] && c->h[i]) {
+    dst->x = c->x[i] * trace_display_info[tr->num].mosaic.w / tr->dimensions +
              trace_display_info[tr->num].mosaic.x;
-    dst->y = t->y * trace_display_info[tr->num].mosaic.h / tr->dimensions +
+    dst->y = c->y[i] * trace_display_info[tr->num].mosaic.h / tr->dimensions +
              trace_display_info[tr->num].mosaic.y;
-    dst->w =
-        ((t->x + t->w) * trace_display_info[tr->num].mosaic.w / tr->dimensions +
-         trace_display_info[tr->num].mosaic.x - dst->x)
-            ?: 1;
-    dst->h =
-        ((t->y + t->h) * trace_display_info[tr->num].mosaic.h / tr->dimensions +
-         trace_display_info[tr->num].mosaic.y - dst->y)
-            ?: 1;
+    dst->w = ((c->x[i] + c->w[i]) * trace_display_info[tr->num].mosaic.w /
+                  tr->dimensions +
+              trace_display_info[tr->num].mosaic.x - dst->x)
+                 ?: 1;
+    dst->h = ((c->y[i] + c->h[i]) * trace_display_info[tr->num].mosaic.h /
+                  tr->dimensions +
+              trace_display_info[tr->num].mosaic.y - dst->y)
+                 ?: 1;
     return 1;
   } else { // task has no associated tile
     dst->x = 0;
@@ -778,14 +812,15 @@ static inline int get_tile_rect (trace_t *tr, trace_task_t *t, SDL_Rect *dst)
   }
 }
 
-static void show_tile (trace_t *tr, trace_task_t *t, unsigned cpu,
+static void show_tile (trace_t *tr, unsigned cpu, unsigned i,
                        unsigned highlight)
 {
   SDL_Rect dst;
+  trace_cpu_t *c = tr->per_cpu + cpu;
   unsigned task_color =
-      is_lane (tr, cpu) ? gpu_index[t->task_type] : (cpu % MAX_COLORS);
+      is_lane (tr, cpu) ? gpu_index[c->task_type[i]] : (cpu % MAX_COLORS);
 
-  get_tile_rect (tr, t, &dst);
+  get_tile_rect (tr, c, i, &dst);
 
   SDL_RenderCopy (
       renderer,
@@ -943,18 +978,20 @@ static void display_bubble (int x, int y, unsigned long duration,
                     with_sigma);
 }
 
+// A task is identified by its trace, its CPU and its index (-1 if none)
 typedef struct
 {
-  trace_task_t *task;
+  int task;
+  unsigned cpu;
   trace_t *trace;
   unsigned iter;
-  long cumulated_duration;
+  long cumulated_duration[MAX_TRACES]; // tracking mode, per trace
   SDL_Rect area;
 } selected_task_info_t;
 
 #define SELECTED_TASK_INFO_INITIALIZER                                         \
   {                                                                            \
-    NULL, NULL, 0, 0,                                                          \
+    -1, 0, NULL, 0, {0},                                                       \
     {                                                                          \
       0, 0, 0, 0                                                               \
     }                                                                          \
@@ -962,9 +999,28 @@ typedef struct
 
 static void selected_task_info_init (selected_task_info_t *info)
 {
-  info->task               = NULL;
-  info->trace              = NULL;
-  info->cumulated_duration = 0;
+  info->task               = -1;
+  info->cpu                = 0;
+  info->trace = NULL;
+  memset (info->cumulated_duration, 0, sizeof (info->cumulated_duration));
+}
+
+static inline int is_selected (const selected_task_info_t *selected,
+                               trace_t *tr, unsigned cpu, int t)
+{
+  return selected->task == t && selected->cpu == cpu && selected->trace == tr;
+}
+
+static inline int selected_task_id (const selected_task_info_t *selected)
+{
+  return selected->trace->per_cpu[selected->cpu].task_id[selected->task];
+}
+
+static inline int selected_task_has_tile (const selected_task_info_t *selected)
+{
+  trace_cpu_t *c = selected->trace->per_cpu + selected->cpu;
+
+  return c->w[selected->task] && c->h[selected->task];
 }
 
 static void display_mouse_selection (const selected_task_info_t *selected)
@@ -982,14 +1038,17 @@ static void display_mouse_selection (const selected_task_info_t *selected)
 
         SDL_RenderCopy (renderer, horizontal_line, NULL, &dst);
 
-        dst.y = get_y_mouse_sibbling ();
-        if (dst.y != mouse.y)
-          SDL_RenderCopy (renderer, horizontal_bis, NULL, &dst);
+        for (int s = 0; s < nb_traces; s++) {
+          dst.y = get_y_mouse_sibbling (s);
+          if (dst.y != mouse.y)
+            SDL_RenderCopy (renderer, horizontal_bis, NULL, &dst);
+        }
       }
     }
   } else {
-    trace_t *tr     = selected->trace;
-    trace_task_t *t = selected->task;
+    trace_t *tr    = selected->trace;
+    trace_cpu_t *c = (tr != NULL ? tr->per_cpu + selected->cpu : NULL);
+    const int t    = selected->task;
 
     // vertical bar
     if (mouse_in_gantt_zone) {
@@ -1011,26 +1070,29 @@ static void display_mouse_selection (const selected_task_info_t *selected)
         SDL_RenderCopy (renderer, vertical_line, NULL, &dst);
       }
 
-      if (t != NULL) {
+      if (t != -1) {
         display_bubble (mouse.x, trace_display_info[tr->num].gantt.y - 4,
-                        t->end_time - t->start_time, 0);
+                        c->end_time[t] - c->start_time[t], 0);
 
         if (tracking_mode) {
           // int iter = selected->iter - tr->first_iteration;
           // int x = (time_to_pixel (iteration_start_time (tr, iter)) +
           //         time_to_pixel (iteration_end_time (tr, iter))) >> 1;
-          int y = trace_display_info[1 - tr->num].gantt.y - 4;
-          display_bubble (mouse.x, y, selected->cumulated_duration, 1);
+          for (int s = 0; s < nb_traces; s++)
+            if (s != tr->num)
+              display_bubble (mouse.x, trace_display_info[s].gantt.y - 4,
+                              selected->cumulated_duration[s], 1);
         }
 
-        if (t->task_id) { // Do not display "anonymous" IDs
-          dst.w = trace_display_info[tr->num].task_ids_tex_width[t->task_id];
+        const int id = c->task_id[t];
+
+        if (id) { // Do not display "anonymous" IDs
+          dst.w = trace_display_info[tr->num].task_ids_tex_width[id];
           dst.h = FONT_HEIGHT;
           dst.x = mouse.x - dst.w / 2;
           dst.y = trace_display_info[tr->num].gantt.y +
                   trace_display_info[tr->num].gantt.h;
-          SDL_RenderCopy (renderer,
-                          trace_display_info[tr->num].task_ids_tex[t->task_id],
+          SDL_RenderCopy (renderer, trace_display_info[tr->num].task_ids_tex[id],
                           NULL, &dst);
         }
       }
@@ -1052,7 +1114,7 @@ static void display_misc_status (void)
 static void display_tile_background (int tr)
 {
 #ifdef PRELOAD_THUMBNAILS
-  static int displayed_iter[MAX_TRACES] = {-1, -1};
+  static int displayed_iter[MAX_TRACES] = {[0 ... MAX_TRACES - 1] = -1};
   static SDL_Texture *tex[MAX_TRACES]   = {NULL};
 
   SDL_RenderCopy (renderer, black_square, NULL, &trace_display_info[tr].mosaic);
@@ -1162,13 +1224,13 @@ static void trace_graphics_display_trace (unsigned _t,
 {
   trace_t *const tr       = trace + _t;
   const unsigned first_it = trace_ctrl[_t].first_displayed_iter - 1;
-  trace_task_t *to_be_emphasized[max_cores];
-  SDL_Rect target_tile_rect; // Only used when mouse is over Mosaic
-  int target_tile = 0;       // Only used when mouse is over Mosaic
-  int cpu         = 0;       // Only used in tracking mode
+  int to_be_emphasized[max_cores]; // task indexes (-1 if none)
+  SDL_Rect target_tile_rect;        // Only used when mouse is over Mosaic
+  int target_tile = 0;              // Only used when mouse is over Mosaic
   unsigned wh     = trace_display_info[_t].gantt.y + Y_MARGIN;
 
-  bzero (to_be_emphasized, max_cores * sizeof (trace_task_t *));
+  for (int c = 0; c < max_cores; c++)
+    to_be_emphasized[c] = -1;
 
   // Set clipping region
   {
@@ -1192,21 +1254,26 @@ static void trace_graphics_display_trace (unsigned _t,
     if (point_inside_gantt (&mouse, _t))
       selected->trace = tr;
 
-    if (horiz_mode && point_inside_gantt (&mouse, 1 - _t)) {
-      virt_mouse.y = get_y_mouse_sibbling ();
+    if (horiz_mode && get_mouse_gantt () != -1 &&
+        !point_inside_gantt (&mouse, _t)) {
+      virt_mouse.y = get_y_mouse_sibbling (_t);
       virt_mouse.x = -1;
     }
   } else {
     if (point_inside_mosaic (&mouse, _t)) {
       // Mouse is over our tile mosaic
       in_mosaic = 1;
-    } else if ((nb_traces > 1) && point_inside_mosaic (&mouse, 1 - _t)) {
-      // Mouse is over the other tile mosaic
-      in_mosaic    = 1;
-      virt_mouse.x = trace_display_info[_t].mosaic.x +
-                     (mouse.x - trace_display_info[1 - _t].mosaic.x);
-      virt_mouse.y = trace_display_info[_t].mosaic.y +
-                     (mouse.y - trace_display_info[1 - _t].mosaic.y);
+    } else {
+      for (int o = 0; o < nb_traces; o++)
+        if (o != _t && point_inside_mosaic (&mouse, o)) {
+          // Mouse is over the tile mosaic of another trace
+          in_mosaic    = 1;
+          virt_mouse.x = trace_display_info[_t].mosaic.x +
+                         (mouse.x - trace_display_info[o].mosaic.x);
+          virt_mouse.y = trace_display_info[_t].mosaic.y +
+                         (mouse.y - trace_display_info[o].mosaic.y);
+          break;
+        }
     }
   }
 
@@ -1214,112 +1281,110 @@ static void trace_graphics_display_trace (unsigned _t,
   // tiles
   if (first_it < tr->nb_iterations)
     for (int c = 0; c < tr->nb_cores; c++) {
-      // We get a pointer on the first task executed by
-      // CPU 'c' at first displayed iteration
-      trace_task_t *first = tr->iteration[first_it].first_cpu_task[c];
-      unsigned task_color = c % MAX_COLORS;
-
-      if (first != NULL)
-        // We follow the list of tasks, starting from this first task
-        list_for_each_entry_from (trace_task_t, t, tr->per_cpu + c, first,
-                                  cpu_chain)
-        {
-          if (task_end_time (tr, t) < start_time)
-            continue;
-
-          // We stop if we encounter a task belonging to a greater iteration
-          if (task_start_time (tr, t) > end_time)
-            break;
-
-          // Ok, this task should appear on the screen
-          SDL_Rect dst;
-
-          // Project the task in the Gantt chart
-          dst.x = time_to_pixel (task_start_time (tr, t));
-          dst.y = wh;
-          dst.w = time_to_pixel (task_end_time (tr, t)) - dst.x + 1;
-          dst.h = TASK_HEIGHT;
+      trace_cpu_t *cpu = tr->per_cpu + c;
+      // Index of the first task executed by CPU 'c' at first displayed
+      // iteration
+      const unsigned first = tr->iteration[first_it].first_cpu_task[c];
+      unsigned task_color  = c % MAX_COLORS;
+
+      for (unsigned t = first; t < cpu->nb_tasks; t++) {
+        if (task_end_time (tr, cpu, t) < start_time)
+          continue;
+
+        // We stop if we encounter a task belonging to a greater iteration
+        if (task_start_time (tr, cpu, t) > end_time)
+          break;
+
+        // Ok, this task should appear on the screen
+        SDL_Rect dst;
+
+        // Project the task in the Gantt chart
+        dst.x = time_to_pixel (task_start_time (tr, cpu, t));
+        dst.y = wh;
+        dst.w = time_to_pixel (task_end_time (tr, cpu, t)) - dst.x + 1;
+        dst.h = TASK_HEIGHT;
+
+        // If task is a GPU tranfer lane, modify height, y-offset and color
+        if (is_lane (tr, c)) {
+          dst.h = TASK_HEIGHT / 2;
+          if (cpu->task_type[t] == TASK_TYPE_READ)
+            dst.y += TASK_HEIGHT / 2;
+
+          task_color = gpu_index[cpu->task_type[t]];
+        }
 
-          // If task is a GPU tranfer lane, modify height, y-offset and color
-          if (is_lane (tr, c)) {
-            dst.h = TASK_HEIGHT / 2;
-            if (t->task_type == TASK_TYPE_READ)
-              dst.y += TASK_HEIGHT / 2;
+        // Check if mouse is within the bounds of the gantt zone
+        if (mouse_in_gantt_zone) {
 
-            task_color = gpu_index[t->task_type];
+          if (horiz_mode && (footprint_mode | point_in_yrange (&dst, virt_mouse.y))) {
+            if (to_be_emphasized[c] == -1)
+              to_be_emphasized[c] =
+                  first; // store a ref to the first task on this lane
           }
 
-          // Check if mouse is within the bounds of the gantt zone
-          if (mouse_in_gantt_zone) {
+          if (point_in_xrange (&dst, virt_mouse.x)) {
+            // vertical line crosses the task
+            if (point_in_yrange (&dst, virt_mouse.y)) {
 
-            if (horiz_mode && (footprint_mode | point_in_yrange (&dst, virt_mouse.y))) {
-              if (to_be_emphasized[c] == NULL)
-                to_be_emphasized[c] =
-                    first; // store a ref to the first task on this lane
-            }
+              selected->task = t;
+              selected->cpu  = c;
 
-            if (point_in_xrange (&dst, virt_mouse.x)) {
-              // vertical line crosses the task
-              if (point_in_yrange (&dst, virt_mouse.y)) {
-
-                selected->task = t;
-
-                if (tracking_mode) {
-                  cpu            = c;
-                  selected->iter = tr->first_iteration + t->iteration;
-                  get_raw_rect (t, &selected->area);
-                }
-                // The task is under the mouse cursor: display it a little
-                // bigger!
-                dst.x -= 3;
-                dst.y -= 3;
-                dst.w += 6;
-                dst.h += 6;
+              if (tracking_mode) {
+                selected->iter = tr->first_iteration + cpu->iteration[t];
+                get_raw_rect (cpu, t, &selected->area);
               }
-
-              if (!horiz_mode && !tracking_mode && t->w &&
-                  t->h) // task has as associated tile to be displayed
-                to_be_emphasized[c] = t;
+              // The task is under the mouse cursor: display it a little
+              // bigger!
+              dst.x -= 3;
+              dst.y -= 3;
+              dst.w += 6;
+              dst.h += 6;
             }
 
-            // If tracking mode is enabled, we highlight tasks which work on
-            // tiles intersecting the working set of selected task
-            if (tracking_mode && selected->task != NULL &&
-                _t != selected->trace->num &&
-                selected->iter == t->iteration + tr->first_iteration &&
-                selected->task->task_id == t->task_id) {
-              SDL_Rect r;
-
-              get_raw_rect (t, &r);
-              if (rects_do_intersect (&r, &selected->area)) {
-                selected->cumulated_duration += t->end_time - t->start_time;
-
-                SDL_RenderCopy (renderer, perf_fill[MAX_COLORS], NULL,
-                                &dst); // white
-                if (to_be_emphasized[c] == NULL)
-                  to_be_emphasized[c] = t;
-              } else
-                SDL_RenderCopy (renderer, perf_fill[task_color], NULL, &dst);
-            } else
-              SDL_RenderCopy (renderer, perf_fill[task_color], NULL, &dst);
+            if (!horiz_mode && !tracking_mode && cpu->w[t] &&
+                cpu->h[t]) // task has as associated tile to be displayed
+              to_be_emphasized[c] = t;
+          }
 
-          } else if (in_mosaic) {
+          // If tracking mode is enabled, we highlight tasks which work on
+          // tiles intersecting the working set of selected task
+          if (tracking_mode && selected->task != -1 &&
+              _t != selected->trace->num &&
+              selected->iter == cpu->iteration[t] + tr->first_iteration &&
+              selected_task_id (selected) == cpu->task_id[t]) {
             SDL_Rect r;
 
-            get_tile_rect (tr, t, &r);
+            get_raw_rect (cpu, t, &r);
+            if (rects_do_intersect (&r, &selected->area)) {
+              selected->cumulated_duration[_t] +=
+                  cpu->end_time[t] - cpu->start_time[t];
 
-            if (point_in_rect (&virt_mouse, &r)) {
-              if (!target_tile) {
-                target_tile      = 1;
-                target_tile_rect = r;
-              }
               SDL_RenderCopy (renderer, perf_fill[MAX_COLORS], NULL,
                               &dst); // white
+              if (to_be_emphasized[c] == -1)
+                to_be_emphasized[c] = t;
             } else
               SDL_RenderCopy (renderer, perf_fill[task_color], NULL, &dst);
           } else
             SDL_RenderCopy (renderer, perf_fill[task_color], NULL, &dst);
-        }
+
+        } else if (in_mosaic) {
+          SDL_Rect r;
+
+          get_tile_rect (tr, cpu, t, &r);
+
+          if (point_in_rect (&virt_mouse, &r)) {
+            if (!target_tile) {
+              target_tile      = 1;
+              target_tile_rect = r;
+            }
+            SDL_RenderCopy (renderer, perf_fill[MAX_COLORS], NULL,
+                            &dst); // white
+          } else
+            SDL_RenderCopy (renderer, perf_fill[task_color], NULL, &dst);
+        } else
+          SDL_RenderCopy (renderer, perf_fill[task_color], NULL, &dst);
+      }
 
       wh += CPU_ROW_HEIGHT;
     }
@@ -1338,61 +1403,60 @@ static void trace_graphics_display_trace (unsigned _t,
                     &target_tile_rect);
   else if (horiz_mode) {
     for (int c = 0; c < tr->nb_cores; c++) {
+      trace_cpu_t *cpu = tr->per_cpu + c;
 
-      if (to_be_emphasized[c] != NULL) {
-        // We follow the list of tasks, starting from this first task
-        list_for_each_entry_from (trace_task_t, t, tr->per_cpu + c,
-                                  to_be_emphasized[c], cpu_chain)
-        {
+      if (to_be_emphasized[c] != -1) {
+        // We go through the tasks, starting from this first task
+        for (unsigned t = to_be_emphasized[c]; t < cpu->nb_tasks; t++) {
           // Skip if the task has no associated tile
-          if (t->w == 0 || t->h == 0)
+          if (cpu->w[t] == 0 || cpu->h[t] == 0)
             continue;
 
-          if (task_end_time (tr, t) < start_time)
+          if (task_end_time (tr, cpu, t) < start_time)
             continue;
 
           // We stop if we encounter a task belonging to a greater iteration
-          if (task_start_time (tr, t) > end_time)
+          if (task_start_time (tr, cpu, t) > end_time)
             break;
 
           // Ok, this task should have its tile displayed
-          show_tile (tr, t, c, (t == selected->task));
+          show_tile (tr, c, t, is_selected (selected, tr, c, t));
         }
       }
     }
   } else if (tracking_mode) {
-    if (selected->task != NULL && selected->task->w && selected->task->h) {
+    if (selected->task != -1 && selected_task_has_tile (selected)) {
       if (selected->trace->num == _t) {
-        show_tile (tr, selected->task, cpu, 1);
+        show_tile (tr, selected->cpu, selected->task, 1);
       } else {
         int raw_iter = selected->iter - tr->first_iteration;
 
         for (int c = 0; c < tr->nb_cores; c++) {
-          if (to_be_emphasized[c] != NULL)
-            // We follow the list of tasks, starting from this first task
-            list_for_each_entry_from (trace_task_t, t, tr->per_cpu + c,
-                                      to_be_emphasized[c], cpu_chain)
-            {
-              if (task_end_time (tr, t) < start_time)
+          trace_cpu_t *cpu = tr->per_cpu + c;
+
+          if (to_be_emphasized[c] != -1)
+            // We go through the tasks, starting from this first task
+            for (unsigned t = to_be_emphasized[c]; t < cpu->nb_tasks; t++) {
+              if (task_end_time (tr, cpu, t) < start_time)
                 continue;
 
               // Skip if the task has no associated tile
-              if (t->w == 0 || t->h == 0)
+              if (cpu->w[t] == 0 || cpu->h[t] == 0)
                 continue;
 
               // Stop when reaching next iteration
-              if (t->iteration > raw_iter)
+              if (cpu->iteration[t] > raw_iter)
                 break;
 
               // Stop if we encounter a task not displayed on screen
-              if (task_start_time (tr, t) > end_time)
+              if (task_start_time (tr, cpu, t) > end_time)
                 break;
 
               SDL_Rect r;
 
-              get_raw_rect (t, &r);
+              get_raw_rect (cpu, t, &r);
               if (rects_do_intersect (&r, &selected->area))
-                show_tile (tr, t, c, 1);
+                show_tile (tr, c, t, 1);
             }
         }
       }
@@ -1401,9 +1465,9 @@ static void trace_graphics_display_trace (unsigned _t,
     // Display tiles corresponding to tasks intersecting with mouse "iso x"
     // axis
     for (int c = 0; c < tr->nb_cores; c++) {
-      if (to_be_emphasized[c] != NULL) {
-        show_tile (tr, to_be_emphasized[c], c,
-                   (to_be_emphasized[c] == selected->task));
+      if (to_be_emphasized[c] != -1) {
+        show_tile (tr, c, to_be_emphasized[c],
+                   is_selected (selected, tr, c, to_be_emphasized[c]));
       }
     }
   }
@@ -1429,23 +1493,28 @@ static void trace_graphics_display (void)
   // Draw the text indicating CPU numbers
   display_text ();
 
-  // We fix the bounds of the "trace loop" so that the trace hovered by the
-  // mouse pointer is displayed first
-  int loop_start = 0;
-  int loop_stop  = nb_traces;
-  int loop_inc   = 1;
-
-  if (nb_traces > 1 && mouse_in_gantt_zone) {
-    if (point_inside_gantt (&mouse, 1)) {
-      loop_start = nb_traces - 1;
-      loop_stop  = -1;
-      loop_inc   = -1;
-    }
+  // Tasks of displayed iterations must be in memory. Traces decoded on demand
+  // also keep one screen of iterations on each side, so that scrolling does
+  // not decode them again at each step
+  for (int _t = 0; _t < nb_traces; _t++) {
+    const int first = trace_ctrl[_t].first_displayed_iter - 1;
+    const int last  = trace_ctrl[_t].last_displayed_iter - 1;
+
+    if (first >= 0 && last >= first)
+      trace_file_fetch_iterations (trace + _t, first, last, last - first + 1);
   }
 
+  // The trace hovered by the mouse pointer is displayed first, so that other
+  // traces know which task is selected
+  int hovered = mouse_in_gantt_zone ? get_mouse_gantt () : -1;
+
+  if (hovered != -1)
+    trace_graphics_display_trace (hovered, &selected);
+
   // main loop
-  for (int _t = loop_start; _t != loop_stop; _t = _t + loop_inc) {
-    trace_graphics_display_trace (_t, &selected);
+  for (int _t = 0; _t < nb_traces; _t++) {
+    if (_t != hovered)
+      trace_graphics_display_trace (_t, &selected);
   } // for (_t)
 
   // Mouse
@@ -1507,8 +1576,8 @@ void trace_graphics_toggle_tracking_mode (void)
 
     trace_graphics_display ();
   } else
-    printf ("Warning: tracking mode is only available when visualizing two "
-            "traces\n");
+    printf ("Warning: tracking mode is only available when visualizing "
+            "several traces\n");
 }
 
 static void trace_graphics_set_quick_nav (int nav)
@@ -1532,59 +1601,56 @@ static void set_bounds (long start, long end)
   }
 }
 
+// Returns the trace having the largest number of iterations
+static int longest_trace (void)
+{
+  int longest = 0;
+
+  for (int t = 1; t < nb_traces; t++)
+    if (trace[t].nb_iterations > trace[longest].nb_iterations)
+      longest = t;
+
+  return longest;
+}
+
 static void update_bounds (void)
 {
-  long start, end;
-  int li[2];
-
-  if (trace_ctrl[0].first_displayed_iter > trace[0].nb_iterations)
-    start = iteration_start_time (
-        trace + nb_traces - 1,
-        trace_ctrl[nb_traces - 1].first_displayed_iter - 1);
-  else if (trace_ctrl[nb_traces - 1].first_displayed_iter >
-           trace[nb_traces - 1].nb_iterations)
-    start =
-        iteration_start_time (trace, trace_ctrl[0].first_displayed_iter - 1);
-  else
-    start = min (
-        iteration_start_time (trace, trace_ctrl[0].first_displayed_iter - 1),
-        iteration_start_time (trace + nb_traces - 1,
-                              trace_ctrl[nb_traces - 1].first_displayed_iter -
-                                  1));
-
-  if (trace_ctrl[0].last_displayed_iter > trace[0].nb_iterations)
-    li[0] = trace[0].nb_iterations - 1;
-  else
-    li[0] = trace_ctrl[0].last_displayed_iter - 1;
+  long start = -1, end = -1;
 
-  if (trace_ctrl[nb_traces - 1].last_displayed_iter >
-      trace[nb_traces - 1].nb_iterations)
-    li[1] = trace[nb_traces - 1].nb_iterations - 1;
-  else
-    li[1] = trace_ctrl[nb_traces - 1].last_displayed_iter - 1;
+  for (int t = 0; t < nb_traces; t++) {
+    int li;
+
+    if (trace_ctrl[t].first_displayed_iter <= trace[t].nb_iterations) {
+      long s = iteration_start_time (trace + t,
+                                     trace_ctrl[t].first_displayed_iter - 1);
+      if (start == -1 || s < start)
+        start = s;
+    }
 
-  end = max (iteration_end_time (trace, li[0]),
-             iteration_end_time (trace + nb_traces - 1, li[1]));
+    if (trace_ctrl[t].last_displayed_iter > trace[t].nb_iterations)
+      li = trace[t].nb_iterations - 1;
+    else
+      li = trace_ctrl[t].last_displayed_iter - 1;
+
+    end = max (end, iteration_end_time (trace + t, li));
+  }
 
   set_bounds (start, end);
 }
 
 static void set_widest_iteration_range (int first, int last)
 {
-  trace_ctrl[0].first_displayed_iter             = first;
-  trace_ctrl[nb_traces - 1].first_displayed_iter = first;
-
-  trace_ctrl[0].last_displayed_iter             = last;
-  trace_ctrl[nb_traces - 1].last_displayed_iter = last;
+  for (int t = 0; t < nb_traces; t++) {
+    trace_ctrl[t].first_displayed_iter = first;
+    trace_ctrl[t].last_displayed_iter  = last;
+  }
 
   update_bounds ();
 }
 
 static void set_iteration_range (int trace_num)
 {
-  if (nb_traces > 1) {
-    int other = 1 - trace_num;
-
+  for (int other = 0; other < nb_traces; other++) {
     trace_ctrl[other].first_displayed_iter =
         trace_ctrl[trace_num].first_displayed_iter;
     trace_ctrl[other].last_displayed_iter =
@@ -1625,9 +1691,7 @@ void trace_graphics_scroll (int delta)
 void trace_graphics_shift_left (void)
 {
   if (quick_nav_mode) {
-    int longest = (trace[0].nb_iterations >= trace[nb_traces - 1].nb_iterations)
-                      ? 0
-                      : nb_traces - 1;
+    int longest = longest_trace ();
 
     if (trace_ctrl[longest].last_displayed_iter < max_iterations) {
       trace_ctrl[longest].first_displayed_iter++;
@@ -1645,9 +1709,7 @@ void trace_graphics_shift_left (void)
 void trace_graphics_shift_right (void)
 {
   if (quick_nav_mode) {
-    int longest = (trace[0].nb_iterations >= trace[nb_traces - 1].nb_iterations)
-                      ? 0
-                      : nb_traces - 1;
+    int longest = longest_trace ();
 
     if (trace_ctrl[longest].first_displayed_iter > 1) {
       trace_ctrl[longest].first_displayed_iter--;
@@ -1667,9 +1729,7 @@ void trace_graphics_zoom_in (void)
   if (quick_nav_mode && (trace_ctrl[0].last_displayed_iter >
                          trace_ctrl[0].first_displayed_iter)) {
 
-    int longest = (trace[0].nb_iterations >= trace[nb_traces - 1].nb_iterations)
-                      ? 0
-                      : nb_traces - 1;
+    int longest = longest_trace ();
 
     trace_ctrl[longest].last_displayed_iter--;
 
@@ -1693,9 +1753,7 @@ void trace_graphics_zoom_in (void)
 void trace_graphics_zoom_out (void)
 {
   if (quick_nav_mode) {
-    int longest = (trace[0].nb_iterations >= trace[nb_traces - 1].nb_iterations)
-                      ? 0
-                      : nb_traces - 1;
+    int longest = longest_trace ();
 
     if (trace_ctrl[longest].last_displayed_iter < max_iterations) {
       trace_ctrl[longest].last_displayed_iter++;
@@ -1846,20 +1904,13 @@ void trace_graphics_reset_zoom (void)
   if (trace_data_align_mode) {
 
     if (!quick_nav_mode) {
-      int first, last;
-
-      if (trace_ctrl[0].first_displayed_iter >
-          trace_ctrl[nb_traces - 1].last_displayed_iter)
-        first = trace_ctrl[0].first_displayed_iter;
-      else if (trace_ctrl[nb_traces - 1].first_displayed_iter >
-               trace_ctrl[0].last_displayed_iter)
-        first = trace_ctrl[nb_traces - 1].first_displayed_iter;
-      else
-        first = min (trace_ctrl[0].first_displayed_iter,
-                     trace_ctrl[nb_traces - 1].first_displayed_iter);
+      int first = -1, last = -1;
 
-      last = max (trace_ctrl[0].last_displayed_iter,
-                  trace_ctrl[nb_traces - 1].last_displayed_iter);
+      for (int t = 0; t < nb_traces; t++) {
+        if (first == -1 || trace_ctrl[t].first_displayed_iter < first)
+          first = trace_ctrl[t].first_displayed_iter;
+        last = max (last, trace_ctrl[t].last_displayed_iter);
+      }
 
       set_widest_iteration_range (first, last);
 
@@ -1893,9 +1944,10 @@ void trace_graphics_toggle_align_mode ()
   SDL_SetTextureAlphaMod (align_tex,
                           trace_data_align_mode ? 0xFF : BUTTON_ALPHA);
 
-  max_time = max (iteration_end_time (trace, trace[0].nb_iterations - 1),
-                  iteration_end_time (trace + nb_traces - 1,
-                                      trace[nb_traces - 1].nb_iterations - 1));
+  max_time = 0;
+  for (int t = 0; t < nb_traces; t++)
+    max_time = max (max_time, iteration_end_time (trace + t,
+                                                  trace[t].nb_iterations - 1));
 
   if (end_time > max_time) {
     end_time = max_time;
@@ -1921,14 +1973,35 @@ void trace_graphics_relayout (unsigned w, unsigned h)
   trace_graphics_display ();
 }
 
+static void compute_maxima (void)
+{
+  max_iterations = max_cores = max_time = 0;
+  for (int t = 0; t < nb_traces; t++) {
+    max_iterations = max (max_iterations, trace[t].nb_iterations);
+    max_cores      = max (max_cores, trace[t].nb_cores);
+    max_time       = max (max_time, iteration_end_time (
+                                        trace + t, trace[t].nb_iterations - 1));
+  }
+}
+
+void trace_graphics_live_update (unsigned dropped)
+{
+  const int first = trace_ctrl[0].first_displayed_iter;
+  const int last  = trace_ctrl[0].last_displayed_iter;
+  // If the last iteration was displayed, we keep following the newest ones
+  const int follow = (last >= max_iterations);
+
+  compute_maxima ();
+
+  if (follow)
+    trace_graphics_setview (max_iterations - (last - first), max_iterations);
+  else
+    trace_graphics_setview (first - dropped, last - dropped);
+}
+
 void trace_graphics_init (unsigned w, unsigned h)
 {
-  max_iterations =
-      max (trace[0].nb_iterations, trace[nb_traces - 1].nb_iterations);
-  max_cores = max (trace[0].nb_cores, trace[nb_traces - 1].nb_cores);
-  max_time  = max (iteration_end_time (trace, trace[0].nb_iterations - 1),
-                  iteration_end_time (trace + nb_traces - 1,
-                                      trace[nb_traces - 1].nb_iterations - 1));
+  compute_maxima ();
 
   const unsigned min_width  = layout_get_min_width ();
   const unsigned min_height = layout_get_min_height ();
@@ -1947,9 +2020,19 @@ void trace_graphics_init (unsigned w, unsigned h)
 
   if (nb_traces == 1)
     sprintf (wintitle, "EasyView Trace Viewer -- \"%s\"", trace[0].label);
-  else
+  else if (nb_traces == 2)
     sprintf (wintitle, "EasyView -- \"%s\" (top) VS \"%s\" (bottom)",
              trace[0].label, trace[1].label);
+  else {
+    // snprintf returns the length the string would have had: stop once
+    // the title is truncated
+    size_t n = snprintf (wintitle, sizeof (wintitle), "EasyView -- \"%s\"",
+                         trace[0].label);
+
+    for (int t = 1; t < nb_traces && n < sizeof (wintitle); t++)
+      n += snprintf (wintitle + n, sizeof (wintitle) - n, " VS \"%s\"",
+                     trace[t].label);
+  }
 
   window = SDL_CreateWindow (wintitle, 0, 0, WINDOW_WIDTH, WINDOW_HEIGHT,
                              SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE);
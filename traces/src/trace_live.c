@@ -0,0 +1,238 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "error.h"
+#include "trace_common.h"
+#include "trace_data.h"
+#include "trace_live.h"
+
+#define LIVE_BUFFER_EVENTS 4096
+// Reads performed by a non-blocking poll, so that the viewer remains
+// responsive when easypap produces events faster than they are ingested
+#define MAX_READS_PER_POLL 64
+
+unsigned trace_live_window = 256;
+
+static int live_fd         = -1;
+static trace_t *live_trace = NULL;
+static unsigned current_iteration; // index in live_trace->iteration
+
+static long *last_start_times                    = NULL;
+static uint64_t (*pending_counters)[NB_COUNTERS] = NULL;
+static char *has_pending_counters                = NULL;
+
+static ezt_live_event_t buffer[LIVE_BUFFER_EVENTS];
+static size_t buffered = 0; // in bytes
+
+static void read_fully (void *data, size_t size)
+{
+  char *p = data;
+
+  while (size > 0) {
+    ssize_t n = recv (live_fd, p, size, 0);
+
+    if (n == 0)
+      exit_with_error ("Live trace: connection closed by easypap");
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      exit_with_error ("Live trace: cannot read (%s)", strerror (errno));
+    }
+    p += n;
+    size -= n;
+  }
+}
+
+void trace_live_connect (char *socket_path)
+{
+  struct sockaddr_un addr;
+  ezt_header_t h;
+  trace_t *tr = &trace[nb_traces];
+  char *strings, *str;
+  unsigned nb_lanes;
+
+  if (strlen (socket_path) >= sizeof (addr.sun_path))
+    exit_with_error ("Socket path \"%s\" is too long", socket_path);
+
+  memset (&addr, 0, sizeof (addr));
+  addr.sun_family = AF_UNIX;
+  strcpy (addr.sun_path, socket_path);
+
+  live_fd = socket (AF_UNIX, SOCK_STREAM, 0);
+  if (live_fd < 0)
+    exit_with_error ("Cannot create socket (%s)", strerror (errno));
+
+  if (connect (live_fd, (struct sockaddr *)&addr, sizeof (addr)) < 0)
+    exit_with_error ("Cannot connect to \"%s\" (%s). Is easypap running with "
+                     "--trace-live?",
+                     socket_path, strerror (errno));
+
+  read_fully (&h, sizeof (h));
+  if (memcmp (h.magic, EZT_MAGIC, 4) || h.version != EZT_VERSION)
+    exit_with_error ("\"%s\" does not stream version %d traces", socket_path,
+                     EZT_VERSION);
+
+  strings = malloc (h.strings_size);
+  read_fully (strings, h.strings_size);
+
+  trace_data_init (tr, nb_traces);
+
+  if (h.nb_gpu & 1) // number of GPU lanes must be even
+    exit_with_error ("Bad trace header: #GPU (= %d) expected to be even",
+                     h.nb_gpu);
+
+  trace_data_set_nb_threads (tr, h.nb_cores, h.nb_gpu);
+  trace_data_set_dim (tr, h.dim);
+  trace_data_set_first_iteration (tr, h.first_iteration);
+  if (h.counters_mask)
+    trace_data_set_counters (tr, h.counters_mask);
+
+  str = strings;
+  trace_data_set_label (tr, *str != '\0' ? str : "live");
+  str += strlen (str) + 1;
+
+  trace_data_alloc_task_ids (tr, h.task_ids_count);
+  for (int i = 0; i < h.task_ids_count; i++) {
+    trace_data_add_taskid (tr, str);
+    str += strlen (str) + 1;
+  }
+  free (strings);
+
+  nb_lanes             = h.nb_cores + h.nb_gpu;
+  last_start_times     = calloc (nb_lanes, sizeof (long));
+  pending_counters     = malloc (nb_lanes * sizeof (*pending_counters));
+  has_pending_counters = calloc (nb_lanes, sizeof (char));
+
+  live_trace        = tr;
+  current_iteration = 0;
+  nb_traces++;
+}
+
+static void ingest (ezt_live_event_t *e, int *completed)
+{
+  trace_t *tr = live_trace;
+
+  if (e->code != TRACE_BEGIN_ITER && e->code != TRACE_END_ITER &&
+      e->code != TRACE_ITER_COUNTERS && e->code != TRACE_ITER_SUMMARY &&
+      e->lane >= tr->nb_cores)
+    exit_with_error ("Live trace: bad lane number (%d)", e->lane);
+
+  switch (e->code) {
+  case TRACE_BEGIN_ITER:
+    trace_data_start_iteration (tr, e->time);
+    break;
+
+  case TRACE_END_ITER:
+    trace_data_end_iteration (tr, e->time);
+    current_iteration++;
+    (*completed)++;
+    break;
+
+  case TRACE_BEGIN_TILE:
+    last_start_times[e->lane] = e->time;
+    break;
+
+  case TRACE_END_TILE:
+    // Tasks recorded outside iterations are dropped
+    if (current_iteration < tr->nb_iterations)
+      trace_data_add_task (
+          tr, last_start_times[e->lane], e->time, (uint32_t)e->param[0],
+          (uint32_t)(e->param[0] >> 32), (uint32_t)e->param[1],
+          (uint32_t)(e->param[1] >> 32), current_iteration, e->lane,
+          TASK_EXTRACT_TTYPE (e->param[2]), TASK_EXTRACT_TID (e->param[2]),
+          has_pending_counters[e->lane] ? pending_counters[e->lane] : NULL);
+    has_pending_counters[e->lane] = 0;
+    break;
+
+  case TRACE_TILE_COUNTERS:
+    for (int c = 0; c < NB_COUNTERS; c++)
+      pending_counters[e->lane][c] = e->param[c];
+    has_pending_counters[e->lane] = 1;
+    break;
+
+  case TRACE_ITER_COUNTERS:
+    if (current_iteration < tr->nb_iterations)
+      trace_data_iteration_counters (tr, e->param);
+    break;
+
+  case TRACE_ITER_SUMMARY:
+    if (current_iteration < tr->nb_iterations)
+      trace_data_iteration_summary (tr, e->param[0], e->param[1],
+                                    e->param[2]);
+    break;
+
+  default:
+    break;
+  }
+}
+
+// Older iterations are dropped once the window is exceeded by 25%, so that
+// moving task arrays is amortized over several iterations
+static unsigned shrink_window (void)
+{
+  trace_t *tr = live_trace;
+  unsigned n;
+
+  if (trace_live_window == 0 ||
+      tr->nb_iterations <= trace_live_window + trace_live_window / 4)
+    return 0;
+
+  n = tr->nb_iterations - trace_live_window;
+  trace_data_drop_iterations (tr, n);
+  current_iteration -= n;
+
+  return n;
+}
+
+int trace_live_poll (int blocking, unsigned *dropped)
+{
+  int completed = 0;
+
+  *dropped = 0;
+
+  if (live_fd == -1)
+    return -1;
+
+  for (int r = 0; blocking ? completed == 0 : r < MAX_READS_PER_POLL; r++) {
+    ssize_t n = recv (live_fd, (char *)buffer + buffered,
+                      sizeof (buffer) - buffered, blocking ? 0 : MSG_DONTWAIT);
+    unsigned nb_events;
+
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      if (errno == EAGAIN || errno == EWOULDBLOCK)
+        break;
+    }
+
+    if (n <= 0) {
+      // easypap is over: the trace is complete
+      close (live_fd);
+      live_fd = -1;
+      break;
+    }
+
+    buffered += n;
+    nb_events = buffered / sizeof (ezt_live_event_t);
+
+    for (unsigned e = 0; e < nb_events; e++)
+      ingest (buffer + e, &completed);
+
+    // Keep the beginning of an incomplete event
+    buffered -= nb_events * sizeof (ezt_live_event_t);
+    memmove (buffer, buffer + nb_events, buffered);
+  }
+
+  *dropped = shrink_window ();
+
+  if (completed == 0 && live_fd == -1)
+    return -1;
+
+  return completed;
+}
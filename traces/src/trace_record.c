@@ -1,9 +1,14 @@
+#include <errno.h>
 #include <fcntl.h>
 #include <getopt.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/un.h>
 #include <unistd.h>
 
 #ifdef ENABLE_FUT
@@ -17,6 +22,8 @@
 #include "error.h"
 #include "trace_common.h"
 #include "trace_data.h"
+#include "trace_ezt.h"
+#include "trace_live.h"
 #include "trace_record.h"
 
 unsigned do_trace          = 0;
@@ -24,30 +31,746 @@ unsigned trace_may_be_used = 0;
 
 static unsigned task_ids_count = 0;
 
+// Traces are written in the native format (see trace_ezt.h) if the file
+// name ends with ".ezt", streamed to easyview (see trace_live.h) if it ends
+// with ".sock", or written through FxT otherwise
+static unsigned native_format  = 0;
+static unsigned live_format    = 0;
+static unsigned fxt_format     = 0;
+static char *trace_file        = NULL;
+static char *label_string      = NULL;
+static char **task_id_strings  = NULL;
+static ezt_header_t header;
+
+// Events are not sent to FxT while computing: each lane (i.e. thread or GPU
+// lane) appends them to its own buffer, so that no synchronization is
+// needed on the hot path. Iteration events go to an extra "global" lane.
+// Buffers are merged by time and written out at the end of iterations, once
+// they hold more than FLUSH_CHUNKS chunks, and by trace_record_finalize.
+// Chunks of flushed lanes are kept for reuse.
+
+#define CHUNK_EVENTS (1 << 13)
+// About 24 MB of events, preallocated among lanes
+#define FLUSH_CHUNKS 64
+#define MIN_LANE_CHUNKS 2
+
+typedef struct
+{
+  long time;
+  uint32_t code;
+  uint32_t cpu;
+  uint64_t param[4];
+} event_t;
+
+typedef struct chunk_s
+{
+  struct chunk_s *next;
+  unsigned nb_events;
+  event_t events[CHUNK_EVENTS];
+} __attribute__ ((aligned (64))) chunk_t;
+
+typedef struct
+{
+  chunk_t *first, *last;
+  chunk_t *spare; // chunks ready for reuse
+  unsigned nb_chunks;
+  // Sampling state: the summary of the current iteration is computed even
+  // for tiles which are not recorded
+  long tile_start;
+  uint64_t nb_tiles, nb_sampled, busy_time;
+  uint32_t seed;
+  unsigned sampling; // current tile is recorded
+} __attribute__ ((aligned (64))) lane_t;
+
+static lane_t *lanes     = NULL;
+static unsigned nb_lanes = 0; // including the global lane
+
+#define GLOBAL_LANE (nb_lanes - 1)
+
+static unsigned sample_every      = 1;
+static unsigned sample_all_tiles  = 1;
+static uint32_t sample_threshold  = 0; // tiles drawing less are recorded
+static long sample_budget         = 0;
+static unsigned iteration_sampled = 1;
+static unsigned iteration_count   = 0;
+static long iteration_start       = 0;
+
+void trace_record_set_sampling (unsigned every, double tile_ratio, long budget)
+{
+  sample_every     = every ? every : 1;
+  sample_all_tiles = (tile_ratio >= 1.0);
+  sample_threshold = (!sample_all_tiles && tile_ratio > 0.0)
+                         ? tile_ratio * 4294967296.0
+                         : 0;
+  sample_budget    = budget;
+}
+
+// xorshift32: lanes draw their own sequence
+static inline uint32_t next_random (lane_t *l)
+{
+  uint32_t x = l->seed;
+
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+
+  return l->seed = x;
+}
+
+static chunk_t *new_chunk (void)
+{
+  chunk_t *c = aligned_alloc (64, sizeof (chunk_t));
+
+  if (c == NULL)
+    exit_with_error ("Cannot allocate trace buffer");
+
+  c->next      = NULL;
+  c->nb_events = 0;
+  return c;
+}
+
+// Allocation only happens when a lane records more events than it was
+// given between two flushes
+static void append_chunk (lane_t *l)
+{
+  chunk_t *c = l->spare;
+
+  if (c != NULL) {
+    l->spare     = c->next;
+    c->next      = NULL;
+    c->nb_events = 0;
+  } else
+    c = new_chunk ();
+
+  l->last->next = c;
+  l->last       = c;
+  l->nb_chunks++;
+}
+
+static inline event_t *new_event (unsigned lane, long time, unsigned code)
+{
+  lane_t *l = lanes + lane;
+  event_t *e;
+
+  if (l->last->nb_events == CHUNK_EVENTS)
+    append_chunk (l);
+
+  e       = l->last->events + l->last->nb_events++;
+  e->time = time;
+  e->code = code;
+  e->cpu  = lane;
+  return e;
+}
+
+static void writers_init (void);
+static void live_listen (void);
+
 void trace_record_init (char *file, unsigned cpu, unsigned gpu, unsigned dim,
                         char *label, unsigned starting_iteration)
 {
-  fut_set_filename (file);
-  enable_fut_flush ();
+  const char *ext = strrchr (file, '.');
 
-  if (fut_setup (BUFFER_SIZE, 0xffff, 0) < 0)
-    exit_with_error ("fut_setup");
+  native_format = (ext != NULL && !strcmp (ext, DEFAULT_EZV_TRACE_EXT));
+  live_format   = (ext != NULL && !strcmp (ext, DEFAULT_EZV_LIVE_EXT));
+  fxt_format    = !native_format && !live_format;
+  trace_file    = strdup (file);
 
   // We use 2 lanes per GPU : one for computations, the other for data transfers
-  FUT_PROBE2 (0x1, TRACE_NB_THREADS, cpu, gpu * 2);
-  FUT_PROBE1 (0x1, TRACE_DIM, dim);
-  if (label != NULL)
-    FUT_PROBESTR (0x1, TRACE_LABEL, label);
-  FUT_PROBE1 (0x1, TRACE_FIRST_ITER, starting_iteration);
+  memset (&header, 0, sizeof (header));
+  memcpy (header.magic, EZT_MAGIC, sizeof (header.magic));
+  header.version         = EZT_VERSION;
+  header.nb_cores        = cpu;
+  header.nb_gpu          = gpu * 2;
+  header.dim             = dim;
+  header.first_iteration = starting_iteration;
+  label_string           = strdup (label != NULL ? label : "");
+
+  if (fxt_format) {
+    fut_set_filename (file);
+    enable_fut_flush ();
+
+    if (fut_setup (BUFFER_SIZE, 0xffff, 0) < 0)
+      exit_with_error ("fut_setup");
+
+    FUT_PROBE2 (0x1, TRACE_NB_THREADS, cpu, gpu * 2);
+    FUT_PROBE1 (0x1, TRACE_DIM, dim);
+    if (label != NULL)
+      FUT_PROBESTR (0x1, TRACE_LABEL, label);
+    FUT_PROBE1 (0x1, TRACE_FIRST_ITER, starting_iteration);
+  }
+
+  nb_lanes = cpu + gpu * 2 + 1;
+  lanes    = aligned_alloc (64, nb_lanes * sizeof (lane_t));
+  if (lanes == NULL)
+    exit_with_error ("Cannot allocate trace lanes");
+
+  for (int l = 0; l < nb_lanes; l++) {
+    memset (lanes + l, 0, sizeof (lane_t));
+    lanes[l].first = lanes[l].last = new_chunk ();
+    lanes[l].nb_chunks             = 1;
+    lanes[l].seed                  = 2463534242U + l;
+
+    // Spare chunks are touched now, so that page faults do not occur while
+    // timing tiles
+    for (int c = 1; c < MIN_LANE_CHUNKS || c < FLUSH_CHUNKS / nb_lanes; c++) {
+      chunk_t *chunk = new_chunk ();
+
+      memset (chunk, 0, sizeof (chunk_t));
+      chunk->next    = lanes[l].spare;
+      lanes[l].spare = chunk;
+    }
+  }
+
+  if (native_format)
+    writers_init ();
+
+  if (live_format)
+    live_listen ();
+}
+
+static void send_event (event_t *e)
+{
+  switch (e->code) {
+  case TRACE_BEGIN_ITER:
+  case TRACE_END_ITER:
+    FUT_PROBE1 (0x1, e->code, e->time);
+    break;
+  case TRACE_BEGIN_TILE:
+    FUT_PROBE2 (0x1, TRACE_BEGIN_TILE, e->time, e->cpu);
+    break;
+  case TRACE_END_TILE:
+    FUT_PROBE7 (0x1, TRACE_END_TILE, e->time, e->cpu,
+                (uint32_t)e->param[0], (uint32_t)(e->param[0] >> 32),
+                (uint32_t)e->param[1], (uint32_t)(e->param[1] >> 32),
+                e->param[2]);
+    break;
+  case TRACE_TILE_COUNTERS:
+    FUT_PROBE5 (0x1, TRACE_TILE_COUNTERS, e->cpu, e->param[0], e->param[1],
+                e->param[2], e->param[3]);
+    break;
+  case TRACE_ITER_COUNTERS:
+    FUT_PROBE4 (0x1, TRACE_ITER_COUNTERS, e->param[0], e->param[1],
+                e->param[2], e->param[3]);
+    break;
+  case TRACE_ITER_SUMMARY:
+    FUT_PROBE3 (0x1, TRACE_ITER_SUMMARY, e->param[0], e->param[1],
+                e->param[2]);
+    break;
+  }
+}
+
+// Among events sharing the same time, the beginning of an iteration comes
+// first and its end comes last
+static inline int event_rank (event_t *e)
+{
+  switch (e->code) {
+  case TRACE_BEGIN_ITER:
+    return 0;
+  case TRACE_END_ITER:
+  case TRACE_ITER_COUNTERS:
+  case TRACE_ITER_SUMMARY:
+    return 2;
+  default:
+    return 1;
+  }
+}
+
+typedef struct
+{
+  chunk_t *chunk;
+  unsigned index;
+} cursor_t;
+
+static inline event_t *cursor_event (cursor_t *c)
+{
+  return c->chunk->events + c->index;
+}
+
+// Lanes are ordered by their next event (time, rank, lane number)
+static inline int cursor_before (cursor_t *a, cursor_t *b)
+{
+  event_t *ea = cursor_event (a), *eb = cursor_event (b);
+
+  if (ea->time != eb->time)
+    return ea->time < eb->time;
+  if (event_rank (ea) != event_rank (eb))
+    return event_rank (ea) < event_rank (eb);
+  return a < b;
+}
+
+static void sift_down (cursor_t **heap, unsigned n, unsigned i)
+{
+  for (;;) {
+    unsigned l = 2 * i + 1, r = l + 1, m = i;
+
+    if (l < n && cursor_before (heap[l], heap[m]))
+      m = l;
+    if (r < n && cursor_before (heap[r], heap[m]))
+      m = r;
+    if (m == i)
+      return;
+
+    cursor_t *tmp = heap[i];
+    heap[i]       = heap[m];
+    heap[m]       = tmp;
+    i             = m;
+  }
+}
+
+// Each lane is already sorted by time: lanes are merged using a binary heap
+static void merge_lanes (void (*consume) (event_t *))
+{
+  cursor_t *cursors = malloc (nb_lanes * sizeof (cursor_t));
+  cursor_t **heap   = malloc (nb_lanes * sizeof (cursor_t *));
+  unsigned n        = 0;
+
+  for (int l = 0; l < nb_lanes; l++) {
+    cursors[l].chunk = lanes[l].first;
+    cursors[l].index = 0;
+    if (lanes[l].first->nb_events > 0)
+      heap[n++] = cursors + l;
+  }
+
+  for (int i = (int)n / 2 - 1; i >= 0; i--)
+    sift_down (heap, n, i);
+
+  while (n > 0) {
+    cursor_t *c = heap[0];
+
+    consume (cursor_event (c));
+
+    if (++c->index == c->chunk->nb_events) {
+      c->chunk = c->chunk->next;
+      c->index = 0;
+      if (c->chunk == NULL || c->chunk->nb_events == 0)
+        heap[0] = heap[--n];
+    }
+    sift_down (heap, n, 0);
+  }
+
+  free (heap);
+  free (cursors);
+}
+
+// Native format writer: events are consumed in time order and tasks are
+// appended to the streams of their lane
+
+typedef struct
+{
+  uint8_t *data;
+  size_t size, capacity;
+} bytes_t;
+
+typedef struct
+{
+  bytes_t stream[EZT_NB_STREAMS];
+  ezt_index_t *index;
+  unsigned nb_index;
+  uint64_t nb_tasks;
+  int64_t prev;
+  long start_time;
+  uint64_t counters[NB_COUNTERS];
+} lane_writer_t;
+
+static lane_writer_t *writers       = NULL;
+static ezt_iteration_t *iterations  = NULL;
+static unsigned iterations_capacity = 0;
+static unsigned current_iteration   = 0;
+
+static void writers_init (void)
+{
+  writers = calloc (nb_lanes - 1, sizeof (lane_writer_t));
+  if (writers == NULL)
+    exit_with_error ("Cannot allocate trace buffers");
+}
+
+static void *grow (void *ptr, unsigned *capacity, unsigned needed,
+                   size_t elem_size)
+{
+  if (needed <= *capacity)
+    return ptr;
+
+  while (*capacity < needed)
+    *capacity = *capacity ? *capacity * 2 : 64;
+
+  ptr = realloc (ptr, *capacity * elem_size);
+  if (ptr == NULL)
+    exit_with_error ("Cannot allocate trace buffers");
+
+  return ptr;
+}
+
+static void put_varint (bytes_t *b, uint64_t v)
+{
+  // A 64-bit varint takes at most 10 bytes
+  if (b->size + 10 > b->capacity) {
+    b->capacity = b->capacity ? b->capacity * 2 : 4096;
+    b->data     = realloc (b->data, b->capacity);
+    if (b->data == NULL)
+      exit_with_error ("Cannot allocate trace buffers");
+  }
+
+  b->size += ezt_put_varint (b->data + b->size, v);
+}
+
+// Makes index entries up to 'it' point to the current end of streams
+static void fill_index (lane_writer_t *w, unsigned it)
+{
+  unsigned capacity = w->nb_index;
+
+  w->index = grow (w->index, &capacity, it + 1, sizeof (ezt_index_t));
+
+  while (w->nb_index <= it) {
+    ezt_index_t *idx = w->index + w->nb_index++;
+
+    idx->first_task = w->nb_tasks;
+    for (int s = 0; s < EZT_NB_STREAMS; s++)
+      idx->offset[s] = w->stream[s].size;
+  }
+}
+
+static void encode_task (lane_writer_t *w, event_t *e)
+{
+  const unsigned it = current_iteration;
+
+  // Tasks recorded outside iterations are dropped
+  if (it >= header.nb_iterations)
+    return;
+
+  if (w->nb_index <= it) {
+    // First task of the lane during this iteration
+    fill_index (w, it);
+    w->prev = iterations[it].start_time;
+  }
+
+  put_varint (w->stream + EZT_STREAM_TIME, ezt_zigzag (w->start_time - w->prev));
+  put_varint (w->stream + EZT_STREAM_TIME, e->time - w->start_time);
+  w->prev = e->time;
+
+  put_varint (w->stream + EZT_STREAM_TILE, (uint32_t)e->param[0]);
+  put_varint (w->stream + EZT_STREAM_TILE, (uint32_t)(e->param[0] >> 32));
+  put_varint (w->stream + EZT_STREAM_TILE, (uint32_t)e->param[1]);
+  put_varint (w->stream + EZT_STREAM_TILE, (uint32_t)(e->param[1] >> 32));
+
+  put_varint (w->stream + EZT_STREAM_TASK, e->param[2]);
+
+  if (header.counters_mask)
+    for (int c = 0; c < NB_COUNTERS; c++) {
+      put_varint (w->stream + EZT_STREAM_COUNTERS, w->counters[c]);
+      w->counters[c] = 0;
+    }
+
+  w->nb_tasks++;
+  header.nb_tasks++;
+}
+
+static void encode_event (event_t *e)
+{
+  switch (e->code) {
+  case TRACE_BEGIN_ITER:
+    iterations = grow (iterations, &iterations_capacity,
+                       header.nb_iterations + 1, sizeof (ezt_iteration_t));
+    memset (iterations + header.nb_iterations, 0, sizeof (ezt_iteration_t));
+    iterations[header.nb_iterations].start_time = e->time;
+    iterations[header.nb_iterations].end_time   = e->time;
+    header.nb_iterations++;
+    break;
+  case TRACE_END_ITER:
+    if (current_iteration < header.nb_iterations)
+      iterations[current_iteration].end_time = e->time;
+    current_iteration++;
+    break;
+  case TRACE_ITER_COUNTERS:
+    if (current_iteration < header.nb_iterations)
+      for (int c = 0; c < NB_COUNTERS; c++)
+        iterations[current_iteration].counters[c] = e->param[c];
+    break;
+  case TRACE_ITER_SUMMARY:
+    if (current_iteration < header.nb_iterations) {
+      iterations[current_iteration].nb_tiles   = e->param[0];
+      iterations[current_iteration].nb_sampled = e->param[1];
+      iterations[current_iteration].busy_time  = e->param[2];
+    }
+    break;
+  case TRACE_BEGIN_TILE:
+    writers[e->cpu].start_time = e->time;
+    break;
+  case TRACE_TILE_COUNTERS:
+    for (int c = 0; c < NB_COUNTERS; c++)
+      writers[e->cpu].counters[c] = e->param[c];
+    break;
+  case TRACE_END_TILE:
+    encode_task (writers + e->cpu, e);
+    break;
+  }
+}
+
+static void write_bytes (FILE *f, const void *data, size_t size)
+{
+  if (size > 0 && fwrite (data, size, 1, f) != 1)
+    exit_with_error ("Cannot write \"%s\" (%s)", trace_file, strerror (errno));
+}
+
+static void write_ezt (void)
+{
+  const unsigned nb_task_lanes = nb_lanes - 1;
+  static const char padding[8] = {0};
+  ezt_lane_t *lane_table;
+  uint64_t offset;
+  FILE *f;
+
+  merge_lanes (encode_event);
+
+  header.strings_size = strlen (label_string) + 1;
+  for (int i = 0; i < task_ids_count; i++)
+    header.strings_size += strlen (task_id_strings[i]) + 1;
+
+  // Streams are stored after the index
+  offset = sizeof (header) + EZT_PAD8 (header.strings_size) +
+           header.nb_iterations * sizeof (ezt_iteration_t) +
+           nb_task_lanes * sizeof (ezt_lane_t) +
+           nb_task_lanes * (header.nb_iterations + 1) * sizeof (ezt_index_t);
+
+  lane_table = malloc (nb_task_lanes * sizeof (ezt_lane_t));
+  for (int l = 0; l < nb_task_lanes; l++) {
+    fill_index (writers + l, header.nb_iterations);
+
+    lane_table[l].nb_tasks = writers[l].nb_tasks;
+    for (int s = 0; s < EZT_NB_STREAMS; s++) {
+      lane_table[l].offset[s] = offset;
+      lane_table[l].size[s]   = writers[l].stream[s].size;
+      offset += writers[l].stream[s].size;
+    }
+  }
+
+  f = fopen (trace_file, "w");
+  if (f == NULL)
+    exit_with_error ("Cannot open \"%s\" (%s)", trace_file, strerror (errno));
+
+  write_bytes (f, &header, sizeof (header));
+  write_bytes (f, label_string, strlen (label_string) + 1);
+  for (int i = 0; i < task_ids_count; i++)
+    write_bytes (f, task_id_strings[i], strlen (task_id_strings[i]) + 1);
+  write_bytes (f, padding,
+               EZT_PAD8 (header.strings_size) - header.strings_size);
+  write_bytes (f, iterations, header.nb_iterations * sizeof (ezt_iteration_t));
+  write_bytes (f, lane_table, nb_task_lanes * sizeof (ezt_lane_t));
+  for (int l = 0; l < nb_task_lanes; l++)
+    write_bytes (f, writers[l].index,
+                 (header.nb_iterations + 1) * sizeof (ezt_index_t));
+  for (int l = 0; l < nb_task_lanes; l++)
+    for (int s = 0; s < EZT_NB_STREAMS; s++)
+      write_bytes (f, writers[l].stream[s].data, writers[l].stream[s].size);
+
+  if (fclose (f) != 0)
+    exit_with_error ("Cannot write \"%s\" (%s)", trace_file, strerror (errno));
+
+  for (int l = 0; l < nb_task_lanes; l++) {
+    for (int s = 0; s < EZT_NB_STREAMS; s++)
+      free (writers[l].stream[s].data);
+    free (writers[l].index);
+  }
+  free (writers);
+  free (lane_table);
+  free (iterations);
+}
+
+// Live traces: each iteration is sent to the connected viewer, if any, then
+// lanes are emptied (see trace_live.h)
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+#define LIVE_BUFFER_EVENTS 4096
+
+static int live_socket = -1;
+static int live_client = -1;
+static unsigned live_iteration; // iteration being sent
+static ezt_live_event_t live_buffer[LIVE_BUFFER_EVENTS];
+static unsigned live_buffered = 0;
+
+static void live_listen (void)
+{
+  struct sockaddr_un addr;
+
+  if (strlen (trace_file) >= sizeof (addr.sun_path))
+    exit_with_error ("Socket path \"%s\" is too long", trace_file);
+
+  memset (&addr, 0, sizeof (addr));
+  addr.sun_family = AF_UNIX;
+  strcpy (addr.sun_path, trace_file);
+
+  live_socket = socket (AF_UNIX, SOCK_STREAM, 0);
+  if (live_socket < 0)
+    exit_with_error ("Cannot create socket (%s)", strerror (errno));
+
+  unlink (trace_file);
+  if (bind (live_socket, (struct sockaddr *)&addr, sizeof (addr)) < 0 ||
+      listen (live_socket, 1) < 0)
+    exit_with_error ("Cannot listen on \"%s\" (%s)", trace_file,
+                     strerror (errno));
+
+  // Viewers are accepted between iterations, without waiting
+  fcntl (live_socket, F_SETFL, O_NONBLOCK);
+
+  live_iteration = header.first_iteration;
+}
+
+static void live_disconnect (void)
+{
+  close (live_client);
+  live_client = -1;
+}
+
+static void live_send (const void *data, size_t size)
+{
+  const char *p = data;
+
+  while (size > 0 && live_client != -1) {
+    ssize_t n = send (live_client, p, size, MSG_NOSIGNAL);
+
+    if (n < 0) {
+      if (errno != EINTR)
+        live_disconnect (); // viewer is gone
+    } else {
+      p += n;
+      size -= n;
+    }
+  }
+}
+
+static void live_accept (void)
+{
+  ezt_header_t h = header;
+  int fd;
+
+  if (live_client != -1)
+    return;
+
+  fd = accept (live_socket, NULL, NULL);
+  if (fd < 0)
+    return;
+
+  // Some systems propagate O_NONBLOCK to accepted sockets
+  fcntl (fd, F_SETFL, fcntl (fd, F_GETFL) & ~O_NONBLOCK);
+#ifdef SO_NOSIGPIPE
+  setsockopt (fd, SOL_SOCKET, SO_NOSIGPIPE, &(int){1}, sizeof (int));
+#endif
+  live_client = fd;
+
+  h.first_iteration = live_iteration;
+  h.nb_iterations   = 0;
+  h.nb_tasks        = 0;
+  h.strings_size    = strlen (label_string) + 1;
+  for (int i = 0; i < task_ids_count; i++)
+    h.strings_size += strlen (task_id_strings[i]) + 1;
+
+  live_send (&h, sizeof (h));
+  live_send (label_string, strlen (label_string) + 1);
+  for (int i = 0; i < task_ids_count; i++)
+    live_send (task_id_strings[i], strlen (task_id_strings[i]) + 1);
+}
+
+static void live_flush_buffer (void)
+{
+  live_send (live_buffer, live_buffered * sizeof (ezt_live_event_t));
+  live_buffered = 0;
+}
+
+static void live_event (event_t *e)
+{
+  ezt_live_event_t *le = live_buffer + live_buffered++;
+
+  le->time = e->time;
+  le->code = e->code;
+  le->lane = e->cpu;
+  memcpy (le->param, e->param, sizeof (le->param));
+
+  if (live_buffered == LIVE_BUFFER_EVENTS)
+    live_flush_buffer ();
+}
+
+// Keeps the first chunk of each lane, other ones become spare chunks
+static void clear_lanes (void)
+{
+  for (int l = 0; l < nb_lanes; l++) {
+    lane_t *lane = lanes + l;
+
+    if (lane->first->next != NULL) {
+      lane->last->next = lane->spare;
+      lane->spare      = lane->first->next;
+    }
+    lane->first->next      = NULL;
+    lane->first->nb_events = 0;
+    lane->last             = lane->first;
+    lane->nb_chunks        = 1;
+  }
+}
+
+// Called at the end of each iteration, when no tile is being computed
+static void live_send_iteration (void)
+{
+  live_accept ();
+
+  if (live_client != -1) {
+    merge_lanes (live_event);
+    live_flush_buffer ();
+  }
+
+  clear_lanes ();
+  live_iteration++;
+}
+
+// Called at the end of each iteration, when no tile is being computed:
+// native traces are encoded (see encode_event) and FxT events are sent, so
+// that memory does not grow with the number of iterations
+static void flush_lanes (void)
+{
+  unsigned nb_chunks = 0;
+
+  for (int l = 0; l < nb_lanes; l++)
+    nb_chunks += lanes[l].nb_chunks;
+
+  if (nb_chunks < FLUSH_CHUNKS)
+    return;
+
+  merge_lanes (native_format ? encode_event : send_event);
+  clear_lanes ();
 }
 
 void trace_record_finalize (void)
 {
-  if (fut_endup ("temp") < 0)
-    exit_with_error ("fut_endup");
+  if (native_format)
+    write_ezt ();
+  else if (fxt_format)
+    merge_lanes (send_event);
+
+  if (live_format) {
+    if (live_client != -1)
+      live_disconnect ();
+    close (live_socket);
+    unlink (trace_file);
+  }
 
-  if (fut_done () < 0)
-    exit_with_error ("fut_done");
+  clear_lanes ();
+  for (int l = 0; l < nb_lanes; l++) {
+    free (lanes[l].first);
+    for (chunk_t *c = lanes[l].spare, *next; c != NULL; c = next) {
+      next = c->next;
+      free (c);
+    }
+  }
+  free (lanes);
+  lanes = NULL;
+
+  if (fxt_format) {
+    if (fut_endup ("temp") < 0)
+      exit_with_error ("fut_endup");
+
+    if (fut_done () < 0)
+      exit_with_error ("fut_done");
+  }
 }
 
 void trace_record_declare_task_ids (char *task_ids[])
@@ -64,11 +787,17 @@ void trace_record_declare_task_ids (char *task_ids[])
     }
   }
 
-  FUT_PROBE1 (0x1, TRACE_TASKID_COUNT, task_ids_count);
-  FUT_PROBESTR (0x1, TRACE_TASKID, "anonymous"); // task id 0
-  if (task_ids != NULL)
-    for (int i = 0; task_ids[i] != NULL; i++)
-      FUT_PROBESTR (0x1, TRACE_TASKID, task_ids[i]); // task id i + 1
+  task_id_strings    = malloc (task_ids_count * sizeof (char *));
+  task_id_strings[0] = "anonymous"; // task id 0
+  for (int i = 1; i < task_ids_count; i++)
+    task_id_strings[i] = strdup (task_ids[i - 1]); // task id i
+  header.task_ids_count = task_ids_count;
+
+  if (fxt_format) {
+    FUT_PROBE1 (0x1, TRACE_TASKID_COUNT, task_ids_count);
+    for (int i = 0; i < task_ids_count; i++)
+      FUT_PROBESTR (0x1, TRACE_TASKID, task_id_strings[i]);
+  }
 }
 
 void trace_record_commit_task_ids (void)
@@ -79,23 +808,52 @@ void trace_record_commit_task_ids (void)
 
 void __trace_record_start_iteration (long time)
 {
-  FUT_PROBE1 (0x1, TRACE_BEGIN_ITER, time);
+  iteration_sampled = (iteration_count++ % sample_every == 0);
+  iteration_start   = time;
+
+  new_event (GLOBAL_LANE, time, TRACE_BEGIN_ITER);
 }
 
 void __trace_record_end_iteration (long time)
 {
-  FUT_PROBE1 (0x1, TRACE_END_ITER, time);
+  event_t *e = new_event (GLOBAL_LANE, time, TRACE_ITER_SUMMARY);
+
+  e->param[0] = e->param[1] = e->param[2] = 0;
+  for (int l = 0; l < GLOBAL_LANE; l++) {
+    e->param[0] += lanes[l].nb_tiles;
+    e->param[1] += lanes[l].nb_sampled;
+    e->param[2] += lanes[l].busy_time;
+    lanes[l].nb_tiles = lanes[l].nb_sampled = lanes[l].busy_time = 0;
+  }
+
+  new_event (GLOBAL_LANE, time, TRACE_END_ITER);
+
+  if (live_format)
+    live_send_iteration ();
+  else
+    flush_lanes ();
 }
 
 void __trace_record_start_tile (long time, unsigned cpu)
 {
-  FUT_PROBE2 (0x1, TRACE_BEGIN_TILE, time, cpu);
+  lane_t *l = lanes + cpu;
+
+  l->tile_start = time;
+  l->sampling =
+      iteration_sampled &&
+      (sample_budget == 0 || time - iteration_start < sample_budget) &&
+      (sample_all_tiles || next_random (l) < sample_threshold);
+
+  if (l->sampling)
+    new_event (cpu, time, TRACE_BEGIN_TILE);
 }
 
 void __trace_record_end_tile (long time, unsigned cpu, unsigned x, unsigned y,
                               unsigned w, unsigned h, int task_type,
                               int task_id)
 {
+  event_t *e;
+
   if (task_id >= task_ids_count)
     exit_with_error (
         "monitoring_end_tile: task id %d is too large (should < %d)%s\n",
@@ -103,6 +861,55 @@ void __trace_record_end_tile (long time, unsigned cpu, unsigned x, unsigned y,
         (task_ids_count == 1)
             ? ". Probable cause: monitoring_declare_task_ids not called"
             : "");
-  FUT_PROBE7 (0x1, TRACE_END_TILE, time, cpu, x, y, w, h,
-              TASK_COMBINE (task_type, task_id));
+
+  lane_t *l = lanes + cpu;
+
+  l->nb_tiles++;
+  l->busy_time += time - l->tile_start;
+  if (!l->sampling)
+    return;
+  l->nb_sampled++;
+
+  e           = new_event (cpu, time, TRACE_END_TILE);
+  e->param[0] = x | ((uint64_t)y << 32);
+  e->param[1] = w | ((uint64_t)h << 32);
+  e->param[2] = TASK_COMBINE (task_type, task_id);
+}
+
+void trace_record_declare_counters (unsigned mask)
+{
+  header.counters_mask = mask;
+
+  if (fxt_format)
+    FUT_PROBE1 (0x1, TRACE_COUNTERS, mask);
+}
+
+// Counters events take the time of the previous event of their lane (the
+// beginning of the tile or iteration), so that they precede the matching
+// end event once merged
+static inline long last_time (unsigned lane)
+{
+  chunk_t *c = lanes[lane].last;
+
+  return c->nb_events ? c->events[c->nb_events - 1].time : 0;
+}
+
+void __trace_record_tile_counters (unsigned cpu, uint64_t values[])
+{
+  if (!lanes[cpu].sampling)
+    return;
+
+  event_t *e = new_event (cpu, last_time (cpu), TRACE_TILE_COUNTERS);
+
+  for (int c = 0; c < NB_COUNTERS; c++)
+    e->param[c] = values[c];
+}
+
+void __trace_record_iteration_counters (uint64_t values[])
+{
+  event_t *e =
+      new_event (GLOBAL_LANE, last_time (GLOBAL_LANE), TRACE_ITER_COUNTERS);
+
+  for (int c = 0; c < NB_COUNTERS; c++)
+    e->param[c] = values[c];
 }
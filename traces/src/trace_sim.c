@@ -0,0 +1,445 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "error.h"
+#include "trace_data.h"
+#include "trace_file.h"
+#include "trace_sim.h"
+
+unsigned trace_sim_workers = 0;
+unsigned trace_sim_chunk   = 1;
+
+// "trace" reports what was recorded, "bound" is the lower bound
+// max (work / P, longest task)
+typedef enum
+{
+  SIM_TRACE,
+  SIM_BOUND,
+  SIM_STATIC,
+  SIM_CYCLIC,
+  SIM_DYNAMIC,
+  SIM_STEALING,
+  SIM_NB_POLICIES
+} sim_policy_t;
+
+static char *policy_names[SIM_NB_POLICIES] = {"trace",  "bound",   "static",
+                                              "cyclic", "dynamic", "stealing"};
+
+typedef struct
+{
+  long makespan;
+  long max_load;
+  double imbalance; // max load / average load - 1
+} sim_result_t;
+
+typedef struct
+{
+  long cost;
+  long start;
+  unsigned x, y;
+} sim_task_t;
+
+typedef struct
+{
+  trace_t *tr;
+  unsigned nb_lanes;   // CPU lanes of the trace
+  unsigned nb_workers; // simulated workers
+  sim_result_t *iter[SIM_NB_POLICIES];
+  sim_result_t total[SIM_NB_POLICIES];
+} trace_sim_t;
+
+// Tasks of an iteration, in tile order
+static sim_task_t *tasks = NULL;
+static unsigned nb_tasks = 0;
+static unsigned capacity = 0;
+static long *load        = NULL; // per worker (or per lane for SIM_TRACE)
+static unsigned *lo, *hi;        // work stealing: tasks [lo, hi) of workers
+
+static int task_cmp (const void *a, const void *b)
+{
+  const sim_task_t *ta = a, *tb = b;
+
+  if (ta->y != tb->y)
+    return ta->y < tb->y ? -1 : 1;
+  if (ta->x != tb->x)
+    return ta->x < tb->x ? -1 : 1;
+  return (ta->start > tb->start) - (ta->start < tb->start);
+}
+
+static void collect_tasks (trace_t *tr, unsigned nb_lanes, unsigned it)
+{
+  trace_file_fetch_iterations (tr, it, it, 0);
+
+  nb_tasks = 0;
+  for (unsigned c = 0; c < nb_lanes; c++) {
+    trace_cpu_t *cpu = tr->per_cpu + c;
+
+    load[c] = 0;
+    for_iteration_tasks (tr, c, it, i) {
+      sim_task_t *t;
+
+      if (nb_tasks == capacity) {
+        capacity = capacity ? capacity * 2 : 1024;
+        tasks    = realloc (tasks, capacity * sizeof (sim_task_t));
+        if (tasks == NULL)
+          exit_with_error ("Cannot allocate simulation data");
+      }
+
+      t        = tasks + nb_tasks++;
+      t->cost  = cpu->end_time[i] - cpu->start_time[i];
+      t->start = cpu->start_time[i];
+      t->x     = cpu->x[i];
+      t->y     = cpu->y[i];
+      load[c] += t->cost;
+    }
+  }
+
+  qsort (tasks, nb_tasks, sizeof (sim_task_t), task_cmp);
+}
+
+static void set_result (sim_result_t *r, unsigned nb_workers)
+{
+  long sum = 0;
+
+  r->max_load = 0;
+  for (unsigned w = 0; w < nb_workers; w++) {
+    sum += load[w];
+    if (load[w] > r->max_load)
+      r->max_load = load[w];
+  }
+
+  r->makespan  = r->max_load;
+  r->imbalance = sum ? (double)r->max_load * nb_workers / sum - 1.0 : 0.0;
+}
+
+// Workers are kept in a binary heap ordered by the time at which they are
+// available (i.e. their load), then by number. Loads only increase: after
+// updating the root, sifting it down is enough.
+
+typedef struct
+{
+  unsigned *w;
+  unsigned n;
+} heap_t;
+
+static inline int worker_before (unsigned a, unsigned b)
+{
+  return load[a] < load[b] || (load[a] == load[b] && a < b);
+}
+
+static void sift_down (heap_t *h, unsigned i)
+{
+  for (;;) {
+    unsigned l = 2 * i + 1, r = l + 1, m = i;
+
+    if (l < h->n && worker_before (h->w[l], h->w[m]))
+      m = l;
+    if (r < h->n && worker_before (h->w[r], h->w[m]))
+      m = r;
+    if (m == i)
+      return;
+
+    unsigned tmp = h->w[i];
+    h->w[i]      = h->w[m];
+    h->w[m]      = tmp;
+    i            = m;
+  }
+}
+
+// All loads are 0: workers sorted by number form a heap
+static void heap_init (heap_t *h, unsigned nb_workers)
+{
+  h->n = nb_workers;
+  for (unsigned w = 0; w < nb_workers; w++) {
+    h->w[w] = w;
+    load[w] = 0;
+  }
+}
+
+// Worker w gets nb_tasks / nb_workers contiguous tasks (the first ones get
+// one more task if needed)
+static inline unsigned block_start (unsigned w, unsigned nb_workers)
+{
+  const unsigned q = nb_tasks / nb_workers, r = nb_tasks % nb_workers;
+
+  return w * q + (w < r ? w : r);
+}
+
+static void simulate_static (unsigned nb_workers)
+{
+  for (unsigned w = 0; w < nb_workers; w++) {
+    const unsigned end = block_start (w + 1, nb_workers);
+
+    load[w] = 0;
+    for (unsigned i = block_start (w, nb_workers); i < end; i++)
+      load[w] += tasks[i].cost;
+  }
+}
+
+static void simulate_cyclic (unsigned nb_workers)
+{
+  memset (load, 0, nb_workers * sizeof (long));
+
+  for (unsigned i = 0; i < nb_tasks; i++)
+    load[i % nb_workers] += tasks[i].cost;
+}
+
+// Chunks of trace_sim_chunk tasks go to the first available worker
+static void simulate_dynamic (heap_t *h, unsigned nb_workers)
+{
+  const unsigned chunk = trace_sim_chunk ? trace_sim_chunk : 1;
+
+  heap_init (h, nb_workers);
+
+  for (unsigned i = 0; i < nb_tasks; i += chunk) {
+    const unsigned end = (i + chunk < nb_tasks) ? i + chunk : nb_tasks;
+    const unsigned w   = h->w[0];
+
+    for (unsigned j = i; j < end; j++)
+      load[w] += tasks[j].cost;
+    sift_down (h, 0);
+  }
+}
+
+// xorshift32, reseeded for each iteration so that results are reproducible
+static inline uint32_t next_random (uint32_t *seed)
+{
+  uint32_t x = *seed;
+
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+
+  return *seed = x;
+}
+
+// Workers start with the static distribution and execute their tasks in
+// order. An idle worker steals the second half of the remaining tasks of
+// a victim, scanning workers from a random one. Steals are free. The next
+// event is always processed by the first available worker, so that a
+// victim never loses a task it has already started.
+static void simulate_stealing (heap_t *h, unsigned nb_workers)
+{
+  uint32_t seed = 2463534242U;
+
+  heap_init (h, nb_workers);
+  for (unsigned w = 0; w < nb_workers; w++) {
+    lo[w] = block_start (w, nb_workers);
+    hi[w] = block_start (w + 1, nb_workers);
+  }
+
+  while (h->n > 0) {
+    const unsigned w = h->w[0];
+
+    if (lo[w] < hi[w]) {
+      load[w] += tasks[lo[w]++].cost;
+      sift_down (h, 0);
+      continue;
+    }
+
+    unsigned first = next_random (&seed) % nb_workers;
+    int victim     = -1;
+
+    for (unsigned k = 0; k < nb_workers; k++) {
+      const unsigned v = (first + k) % nb_workers;
+
+      if (v != w && hi[v] - lo[v] >= 2) {
+        victim = v;
+        break;
+      }
+    }
+
+    if (victim == -1) {
+      // Nothing left to steal: w is done
+      h->w[0] = h->w[--h->n];
+      sift_down (h, 0);
+    } else {
+      const unsigned half = (hi[victim] - lo[victim]) / 2;
+
+      hi[w] = hi[victim];
+      lo[w] = hi[victim] - half;
+      hi[victim] -= half;
+    }
+  }
+}
+
+static void simulate (trace_t *tr, trace_sim_t *sim)
+{
+  unsigned max_workers;
+  long total_work = 0;
+  int sampled     = 0;
+  heap_t h;
+
+  sim->tr = tr;
+  // GPU lanes are ignored, unless there is no CPU lane
+  sim->nb_lanes   = (tr->nb_cores > tr->nb_gpu) ? tr->nb_cores - tr->nb_gpu
+                                                : tr->nb_cores;
+  sim->nb_workers = trace_sim_workers ? trace_sim_workers : sim->nb_lanes;
+  max_workers     = (sim->nb_workers > sim->nb_lanes) ? sim->nb_workers
+                                                      : sim->nb_lanes;
+
+  load = malloc (max_workers * sizeof (long));
+  lo   = malloc (sim->nb_workers * sizeof (unsigned));
+  hi   = malloc (sim->nb_workers * sizeof (unsigned));
+  h.w  = malloc (sim->nb_workers * sizeof (unsigned));
+  if (load == NULL || lo == NULL || hi == NULL || h.w == NULL)
+    exit_with_error ("Cannot allocate simulation data");
+
+  for (int p = 0; p < SIM_NB_POLICIES; p++) {
+    sim->iter[p] = calloc (tr->nb_iterations, sizeof (sim_result_t));
+    if (sim->iter[p] == NULL)
+      exit_with_error ("Cannot allocate simulation data");
+    memset (sim->total + p, 0, sizeof (sim_result_t));
+  }
+
+  for (unsigned it = 0; it < tr->nb_iterations; it++) {
+    sim_result_t *r[SIM_NB_POLICIES];
+    long work = 0, longest = 0;
+
+    for (int p = 0; p < SIM_NB_POLICIES; p++)
+      r[p] = sim->iter[p] + it;
+
+    if (tr->iteration[it].nb_sampled < tr->iteration[it].nb_tiles)
+      sampled = 1;
+
+    collect_tasks (tr, sim->nb_lanes, it);
+
+    set_result (r[SIM_TRACE], sim->nb_lanes);
+    r[SIM_TRACE]->makespan =
+        tr->iteration[it].end_time - tr->iteration[it].start_time;
+
+    for (unsigned i = 0; i < nb_tasks; i++) {
+      work += tasks[i].cost;
+      if (tasks[i].cost > longest)
+        longest = tasks[i].cost;
+    }
+    r[SIM_BOUND]->max_load = r[SIM_BOUND]->makespan =
+        ((work + sim->nb_workers - 1) / sim->nb_workers > longest)
+            ? (work + sim->nb_workers - 1) / sim->nb_workers
+            : longest;
+
+    simulate_static (sim->nb_workers);
+    set_result (r[SIM_STATIC], sim->nb_workers);
+
+    simulate_cyclic (sim->nb_workers);
+    set_result (r[SIM_CYCLIC], sim->nb_workers);
+
+    simulate_dynamic (&h, sim->nb_workers);
+    set_result (r[SIM_DYNAMIC], sim->nb_workers);
+
+    simulate_stealing (&h, sim->nb_workers);
+    set_result (r[SIM_STEALING], sim->nb_workers);
+
+    for (int p = 0; p < SIM_NB_POLICIES; p++) {
+      sim->total[p].makespan += r[p]->makespan;
+      sim->total[p].max_load += r[p]->max_load;
+    }
+    total_work += work;
+  }
+
+  // Whole trace imbalance is computed as in trace_stats.c
+  for (int p = 0; p < SIM_NB_POLICIES; p++) {
+    const unsigned n = (p == SIM_TRACE) ? sim->nb_lanes : sim->nb_workers;
+
+    if (total_work > 0 && p != SIM_BOUND)
+      sim->total[p].imbalance =
+          (double)sim->total[p].max_load * n / total_work - 1.0;
+  }
+
+  if (sampled)
+    fprintf (stderr,
+             "Warning: trace #%d is sampled: only recorded tiles are "
+             "replayed\n",
+             tr->num);
+
+  free (load);
+  free (lo);
+  free (hi);
+  free (h.w);
+}
+
+static void free_sim (trace_sim_t *sim)
+{
+  for (int p = 0; p < SIM_NB_POLICIES; p++)
+    free (sim->iter[p]);
+}
+
+// CSV output uses one row per value: trace;label;policy;metric;index;value
+// where index is an iteration number or is empty for whole-trace values
+
+static void print_csv_value (trace_sim_t *sim, int p, char *metric,
+                             long index, int has_index, double value)
+{
+  trace_stats_print_csv_row (sim->tr, policy_names[p], metric, index,
+                             has_index, value);
+}
+
+static void print_csv (trace_sim_t *sim)
+{
+  trace_t *tr = sim->tr;
+
+  for (int p = 0; p < SIM_NB_POLICIES; p++) {
+    for (unsigned it = 0; it < tr->nb_iterations; it++) {
+      const long num = tr->first_iteration + it;
+
+      print_csv_value (sim, p, "makespan", num, 1, sim->iter[p][it].makespan);
+      print_csv_value (sim, p, "imbalance", num, 1,
+                       sim->iter[p][it].imbalance);
+    }
+
+    print_csv_value (sim, p, "makespan", 0, 0, sim->total[p].makespan);
+    print_csv_value (sim, p, "imbalance", 0, 0, sim->total[p].imbalance);
+  }
+}
+
+static void print_json (trace_sim_t *sim, int last)
+{
+  trace_t *tr = sim->tr;
+
+  printf ("  {\n    \"trace\": %d,\n    \"label\": ", tr->num);
+  trace_stats_print_json_string (tr->label);
+  printf (",\n    \"workers\": %u,\n    \"chunk\": %u,\n    \"policies\": {\n",
+          sim->nb_workers, trace_sim_chunk);
+
+  for (int p = 0; p < SIM_NB_POLICIES; p++) {
+    printf ("      \"%s\": {\n        \"makespan\": %ld, \"imbalance\": %g,\n"
+            "        \"iterations\": [\n",
+            policy_names[p], sim->total[p].makespan, sim->total[p].imbalance);
+
+    for (unsigned it = 0; it < tr->nb_iterations; it++)
+      printf ("          { \"iteration\": %d, \"makespan\": %ld, "
+              "\"imbalance\": %g }%s\n",
+              tr->first_iteration + it, sim->iter[p][it].makespan,
+              sim->iter[p][it].imbalance,
+              (it + 1 < tr->nb_iterations) ? "," : "");
+
+    printf ("        ]\n      }%s\n", (p + 1 < SIM_NB_POLICIES) ? "," : "");
+  }
+
+  printf ("    }\n  }%s\n", last ? "" : ",");
+}
+
+void trace_sim_print (stats_format_t format)
+{
+  if (format == STATS_FORMAT_CSV)
+    printf ("trace;label;policy;metric;index;value\n");
+  else
+    printf ("[\n");
+
+  for (unsigned t = 0; t < nb_traces; t++) {
+    trace_sim_t sim;
+
+    simulate (trace + t, &sim);
+
+    if (format == STATS_FORMAT_CSV)
+      print_csv (&sim);
+    else
+      print_json (&sim, t + 1 == nb_traces);
+
+    free_sim (&sim);
+  }
+
+  if (format == STATS_FORMAT_JSON)
+    printf ("]\n");
+}
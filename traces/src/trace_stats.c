@@ -0,0 +1,283 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "error.h"
+#include "trace_data.h"
+#include "trace_file.h"
+#include "trace_stats.h"
+
+// Task durations are counted in buckets [2^k, 2^(k+1)) µs (bucket 0 also
+// holds zero-length tasks)
+#define NB_BUCKETS 32
+
+typedef struct
+{
+  long duration;      // from the beginning to the end of the iteration
+  long work;          // sum of task durations
+  long max_lane_work; // work of the busiest lane
+  long critical_path; // longest task
+  double imbalance;   // max_lane_work / average lane work - 1
+  long tiles;         // all tiles, including those which were not sampled
+  long sampled_tiles; // tiles recorded in the trace
+  long busy;          // sum of durations of all tiles, on all lanes
+} iteration_stats_t;
+
+typedef struct
+{
+  trace_t *tr;
+  unsigned nb_lanes; // lanes taken into account for imbalance and work
+  int has_summary;   // trace holds TRACE_ITER_SUMMARY events (sampling)
+  iteration_stats_t *iter;
+  iteration_stats_t total; // whole trace (critical path = sum over
+                           // iterations, since iterations are sequential)
+  long *lane_work;         // per lane, all iterations
+  double *lane_idle;       // per lane, fraction of iteration time spent idle
+  unsigned long histogram[NB_BUCKETS];
+} trace_stats_t;
+
+static unsigned bucket_of (long duration)
+{
+  unsigned b = 0;
+
+  while (duration > 1 && b < NB_BUCKETS - 1) {
+    duration >>= 1;
+    b++;
+  }
+
+  return b;
+}
+
+static double speedup_bound (const iteration_stats_t *s)
+{
+  return s->critical_path ? (double)s->work / s->critical_path : 0.0;
+}
+
+static void compute_stats (trace_t *tr, trace_stats_t *st)
+{
+  long *work = calloc (tr->nb_cores, sizeof (long)); // of current iteration
+
+  st->tr = tr;
+  // GPU lanes are only reported in idle ratios, unless there is no CPU lane
+  st->nb_lanes  = (tr->nb_cores > tr->nb_gpu) ? tr->nb_cores - tr->nb_gpu
+                                              : tr->nb_cores;
+  st->iter      = calloc (tr->nb_iterations, sizeof (iteration_stats_t));
+  st->lane_work = calloc (tr->nb_cores, sizeof (long));
+  st->lane_idle = calloc (tr->nb_cores, sizeof (double));
+  memset (&st->total, 0, sizeof (st->total));
+  memset (st->histogram, 0, sizeof (st->histogram));
+  st->has_summary = 0;
+
+  if (work == NULL || st->iter == NULL || st->lane_work == NULL ||
+      st->lane_idle == NULL)
+    exit_with_error ("Cannot allocate statistics");
+
+  for (unsigned it = 0; it < tr->nb_iterations; it++) {
+    iteration_stats_t *s    = st->iter + it;
+    trace_iteration_t *iter = tr->iteration + it;
+
+    s->duration      = iter->end_time - iter->start_time;
+    s->tiles         = iter->nb_tiles;
+    s->sampled_tiles = iter->nb_sampled;
+    s->busy          = iter->busy_time;
+    if (s->tiles > 0)
+      st->has_summary = 1;
+
+    // Native traces are decoded one iteration at a time
+    trace_file_fetch_iterations (tr, it, it, 0);
+
+    for (unsigned c = 0; c < tr->nb_cores; c++) {
+      trace_cpu_t *cpu = tr->per_cpu + c;
+
+      work[c] = 0;
+      for_iteration_tasks (tr, c, it, i) {
+        const long d = cpu->end_time[i] - cpu->start_time[i];
+
+        work[c] += d;
+        if (c < st->nb_lanes) {
+          if (d > s->critical_path)
+            s->critical_path = d;
+          st->histogram[bucket_of (d)]++;
+        }
+      }
+      st->lane_work[c] += work[c];
+
+      if (c < st->nb_lanes) {
+        s->work += work[c];
+        if (work[c] > s->max_lane_work)
+          s->max_lane_work = work[c];
+      }
+    }
+
+    if (s->work > 0)
+      s->imbalance = (double)s->max_lane_work * st->nb_lanes / s->work - 1.0;
+
+    st->total.duration += s->duration;
+    st->total.work += s->work;
+    st->total.max_lane_work += s->max_lane_work;
+    st->total.critical_path += s->critical_path;
+    st->total.tiles += s->tiles;
+    st->total.sampled_tiles += s->sampled_tiles;
+    st->total.busy += s->busy;
+  }
+
+  if (st->total.work > 0)
+    st->total.imbalance =
+        (double)st->total.max_lane_work * st->nb_lanes / st->total.work - 1.0;
+
+  for (unsigned c = 0; c < tr->nb_cores; c++)
+    st->lane_idle[c] =
+        st->total.duration
+            ? 1.0 - (double)st->lane_work[c] / st->total.duration
+            : 0.0;
+
+  free (work);
+}
+
+static void free_stats (trace_stats_t *st)
+{
+  free (st->iter);
+  free (st->lane_work);
+  free (st->lane_idle);
+}
+
+// CSV output uses one row per value: trace;label;metric;index;value where
+// index is an iteration number, a lane number, a histogram bucket (lower
+// bound, in µs) or is empty for whole-trace values
+
+static void print_csv_value (trace_stats_t *st, char *metric, long index,
+                             int has_index, double value)
+{
+  trace_stats_print_csv_row (st->tr, NULL, metric, index, has_index, value);
+}
+
+static void print_csv (trace_stats_t *st)
+{
+  trace_t *tr = st->tr;
+
+  for (unsigned it = 0; it < tr->nb_iterations; it++) {
+    iteration_stats_t *s = st->iter + it;
+    const long num       = tr->first_iteration + it;
+
+    print_csv_value (st, "duration", num, 1, s->duration);
+    print_csv_value (st, "work", num, 1, s->work);
+    print_csv_value (st, "imbalance", num, 1, s->imbalance);
+    print_csv_value (st, "critical_path", num, 1, s->critical_path);
+    print_csv_value (st, "speedup_bound", num, 1, speedup_bound (s));
+    if (st->has_summary) {
+      print_csv_value (st, "tiles", num, 1, s->tiles);
+      print_csv_value (st, "sampled_tiles", num, 1, s->sampled_tiles);
+      print_csv_value (st, "busy", num, 1, s->busy);
+    }
+  }
+
+  for (unsigned c = 0; c < tr->nb_cores; c++)
+    print_csv_value (st, "idle", c, 1, st->lane_idle[c]);
+
+  for (unsigned b = 0; b < NB_BUCKETS; b++)
+    if (st->histogram[b])
+      print_csv_value (st, "histogram", b ? 1L << b : 0, 1, st->histogram[b]);
+
+  print_csv_value (st, "duration", 0, 0, st->total.duration);
+  print_csv_value (st, "work", 0, 0, st->total.work);
+  print_csv_value (st, "imbalance", 0, 0, st->total.imbalance);
+  print_csv_value (st, "critical_path", 0, 0, st->total.critical_path);
+  print_csv_value (st, "speedup_bound", 0, 0, speedup_bound (&st->total));
+  if (st->has_summary) {
+    print_csv_value (st, "tiles", 0, 0, st->total.tiles);
+    print_csv_value (st, "sampled_tiles", 0, 0, st->total.sampled_tiles);
+    print_csv_value (st, "busy", 0, 0, st->total.busy);
+  }
+}
+
+static void print_json_iteration (trace_stats_t *st, iteration_stats_t *s)
+{
+  printf ("\"duration\": %ld, \"work\": %ld, \"imbalance\": %g, "
+          "\"critical_path\": %ld, \"speedup_bound\": %g",
+          s->duration, s->work, s->imbalance, s->critical_path,
+          speedup_bound (s));
+  if (st->has_summary)
+    printf (", \"tiles\": %ld, \"sampled_tiles\": %ld, \"busy\": %ld",
+            s->tiles, s->sampled_tiles, s->busy);
+}
+
+static void print_json (trace_stats_t *st, int last)
+{
+  trace_t *tr = st->tr;
+  int first   = 1;
+
+  printf ("  {\n    \"trace\": %d,\n    \"label\": ", tr->num);
+  trace_stats_print_json_string (tr->label);
+  printf (",\n    \"lanes\": %d,\n    \"total\": { ", tr->nb_cores);
+  print_json_iteration (st, &st->total);
+  printf (" },\n    \"iterations\": [\n");
+
+  for (unsigned it = 0; it < tr->nb_iterations; it++) {
+    printf ("      { \"iteration\": %d, ", tr->first_iteration + it);
+    print_json_iteration (st, st->iter + it);
+    printf (" }%s\n", (it + 1 < tr->nb_iterations) ? "," : "");
+  }
+
+  printf ("    ],\n    \"idle\": [");
+  for (unsigned c = 0; c < tr->nb_cores; c++)
+    printf ("%s%g", c ? ", " : "", st->lane_idle[c]);
+
+  printf ("],\n    \"histogram\": {");
+  for (unsigned b = 0; b < NB_BUCKETS; b++)
+    if (st->histogram[b]) {
+      printf ("%s\"%ld\": %lu", first ? " " : ", ", b ? 1L << b : 0,
+              st->histogram[b]);
+      first = 0;
+    }
+  printf (" }\n  }%s\n", last ? "" : ",");
+}
+
+void trace_stats_print_csv_row (trace_t *tr, char *policy, char *metric,
+                                long index, int has_index, double value)
+{
+  printf ("%d;%s;", tr->num, tr->label);
+  if (policy != NULL)
+    printf ("%s;", policy);
+  printf ("%s;", metric);
+  if (has_index)
+    printf ("%ld", index);
+  printf (";%.15g\n", value);
+}
+
+void trace_stats_print_json_string (const char *s)
+{
+  putchar ('"');
+  for (; *s; s++) {
+    if (*s == '"' || *s == '\\')
+      printf ("\\%c", *s);
+    else if ((unsigned char)*s < 0x20)
+      printf ("\\u%04x", *s);
+    else
+      putchar (*s);
+  }
+  putchar ('"');
+}
+
+void trace_stats_print (stats_format_t format)
+{
+  if (format == STATS_FORMAT_CSV)
+    printf ("trace;label;metric;index;value\n");
+  else
+    printf ("[\n");
+
+  for (unsigned t = 0; t < nb_traces; t++) {
+    trace_stats_t st;
+
+    compute_stats (trace + t, &st);
+
+    if (format == STATS_FORMAT_CSV)
+      print_csv (&st);
+    else
+      print_json (&st, t + 1 == nb_traces);
+
+    free_stats (&st);
+  }
+
+  if (format == STATS_FORMAT_JSON)
+    printf ("]\n");
+}